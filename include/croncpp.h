@@ -6,9 +6,29 @@
 #include <string_view>
 #include <bitset>
 #include <cctype>
+#include <cstdint>
 #include <ctime>
 #include <iomanip>
+#include <limits>
 #include <algorithm>
+#include <charconv>
+#include <tuple>
+
+#if defined(__AVX2__)
+#define CRONCPP_AVX2
+#endif
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#define CRONCPP_SSE2
+#endif
+
+#if defined(CRONCPP_SSE2) || defined(CRONCPP_AVX2)
+#include <immintrin.h>
+#endif
+
+// utils::lowest_bit() uses _BitScanForward on every MSVC target
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
 
 namespace cron
 {
@@ -238,15 +258,72 @@ namespace cron
          return text;
       }
 
-      static std::vector<std::string> split(std::string_view text, char const delimiter)
+
+      inline unsigned lowest_bit(std::uint32_t const mask) noexcept
       {
-         std::vector<std::string> tokens;
-         std::string token;
-         std::istringstream tokenStream(text.data());
-         while (std::getline(tokenStream, token, delimiter))
+#ifdef _MSC_VER
+         unsigned long index = 0;
+         _BitScanForward(&index, mask);
+         return static_cast<unsigned>(index);
+#else
+         return static_cast<unsigned>(__builtin_ctz(mask));
+#endif
+      }
+
+      // Calls fn with a view of each token of text, like split() but without
+      // copying: a trailing empty token is dropped. Delimiters are located 32
+      // (AVX2) or 16 (SSE2) bytes at a time, and one by one in the tail.
+      template <typename F>
+      static void for_each_token(std::string_view text, char const delimiter, F&& fn)
+      {
+         size_t start = 0;
+         size_t i = 0;
+
+         auto const emit = [&](std::uint32_t mask, size_t const offset) {
+            while (mask != 0)
+            {
+               auto const pos = offset + lowest_bit(mask);
+               fn(text.substr(start, pos - start));
+               start = pos + 1;
+               mask &= mask - 1;
+            }
+         };
+
+#ifdef CRONCPP_AVX2
+         auto const wide = _mm256_set1_epi8(delimiter);
+         for (; i + 32 <= text.size(); i += 32)
+         {
+            auto const block = _mm256_loadu_si256(reinterpret_cast<__m256i const *>(text.data() + i));
+            emit(static_cast<std::uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(block, wide))), i);
+         }
+#endif
+#ifdef CRONCPP_SSE2
+         auto const narrow = _mm_set1_epi8(delimiter);
+         for (; i + 16 <= text.size(); i += 16)
+         {
+            auto const block = _mm_loadu_si128(reinterpret_cast<__m128i const *>(text.data() + i));
+            emit(static_cast<std::uint32_t>(_mm_movemask_epi8(_mm_cmpeq_epi8(block, narrow))), i);
+         }
+#endif
+         for (; i < text.size(); ++i)
          {
-            tokens.push_back(token);
+            if (text[i] == delimiter)
+            {
+               fn(text.substr(start, i - start));
+               start = i + 1;
+            }
          }
+
+         if (start < text.size())
+            fn(text.substr(start));
+      }
+
+      inline std::vector<std::string> split(std::string_view text, char const delimiter)
+      {
+         std::vector<std::string> tokens;
+         for_each_token(text, delimiter, [&tokens](std::string_view const token) {
+            tokens.emplace_back(token);
+         });
          return tokens;
       }
 
@@ -254,41 +331,124 @@ namespace cron
       {
          return std::string_view::npos != text.find_first_of(ch);
       }
+
+      // FNV-1a hash of a job key, for the H token of make_cron().
+      constexpr inline std::uint64_t hash_key(std::string_view key) noexcept
+      {
+         std::uint64_t hash = 0xcbf29ce484222325ull;
+         for (auto const ch : key)
+         {
+            hash ^= static_cast<unsigned char>(ch);
+            hash *= 0x100000001b3ull;
+         }
+         return hash;
+      }
    }
 
    namespace detail
    {
 
+      // Like std::stoul(), reads the leading digits of text.
       inline cron_int to_cron_int(std::string_view text)
       {
-         try
-         {
-            return static_cast<cron_int>(std::stoul(text.data()));
-         }
-         catch (std::exception const & ex)
-         {
-            throw bad_cronexpr(ex.what());
-         }
+         unsigned long value = 0;
+         auto const [end, error] = std::from_chars(text.data(), text.data() + text.size(), value);
+         if (error == std::errc::invalid_argument)
+            throw bad_cronexpr("Invalid number in cron expression");
+         if (error == std::errc::result_out_of_range || value > std::numeric_limits<cron_int>::max())
+            throw bad_cronexpr("Number out of range in cron expression");
+
+         return static_cast<cron_int>(value);
       }
 
-      static std::string replace_ordinals(
-         std::string text, 
-         std::vector<std::string> const & replacement)
+      enum class cron_name_kind : std::uint8_t { none, month, day };
+
+      struct cron_name_entry
       {
-         for (size_t i = 0; i < replacement.size(); ++i)
+         char           name[3];
+         cron_name_kind kind;
+         std::uint8_t   index;
+      };
+
+      struct cron_name_table
+      {
+         cron_name_entry entries[64];
+         bool            perfect;
+      };
+
+      constexpr char CRON_MONTH_NAMES[12][4] = { "JAN", "FEB", "MAR", "APR", "MAY", "JUN", "JUL", "AUG", "SEP", "OCT", "NOV", "DEC" };
+      constexpr char CRON_DAY_NAMES[7][4] = { "SUN", "MON", "TUE", "WED", "THU", "FRI", "SAT" };
+
+      // Perfect hash of the month and day names. Masking a letter with 0x1F
+      // gives the same value for both cases, so no upper-case copy is needed.
+      constexpr unsigned name_hash(char const a, char const b, char const c) noexcept
+      {
+         return ((a & 0x1F) + 5 * (b & 0x1F) + (c & 0x1F)) & 63;
+      }
+
+      constexpr cron_name_table make_name_table() noexcept
+      {
+         cron_name_table table{};
+         table.perfect = true;
+
+         auto const add = [&table](char const (&name)[4], cron_name_kind const kind, size_t const index) {
+            auto & entry = table.entries[name_hash(name[0], name[1], name[2])];
+            if (entry.kind != cron_name_kind::none)
+               table.perfect = false;
+            entry = cron_name_entry{ { name[0], name[1], name[2] }, kind, static_cast<std::uint8_t>(index) };
+         };
+
+         for (size_t i = 0; i < 12; ++i)
+            add(CRON_MONTH_NAMES[i], cron_name_kind::month, i);
+         for (size_t i = 0; i < 7; ++i)
+            add(CRON_DAY_NAMES[i], cron_name_kind::day, i);
+
+         return table;
+      }
+
+      constexpr cron_name_table CRON_NAMES = make_name_table();
+      static_assert(CRON_NAMES.perfect, "month and day names must hash to distinct slots");
+
+      // Position of a month (JAN first) or day (SUN first) name in any case,
+      // or -1 if text is not a name of that kind.
+      constexpr int find_name(std::string_view text, cron_name_kind const kind) noexcept
+      {
+         if (text.size() != 3)
+            return -1;
+
+         auto const & entry = CRON_NAMES.entries[name_hash(text[0], text[1], text[2])];
+         if (entry.kind != kind || kind == cron_name_kind::none)
+            return -1;
+
+         // clearing 0x20 maps only a-z and A-Z onto the upper-case letters
+         for (size_t i = 0; i < 3; ++i)
          {
-            auto pos = text.find(replacement[i]);
-            if (std::string::npos != pos)
-               text.replace(pos, 3 ,std::to_string(i));
+            if ((text[i] & ~0x20) != entry.name[i])
+               return -1;
          }
 
-         return text;
+         return entry.index;
+      }
+
+      // A number, or for day and month fields also a name; a name counts
+      // from the minimum of the field.
+      inline cron_int to_cron_value(
+         std::string_view text,
+         cron_int const minval,
+         cron_name_kind const names)
+      {
+         auto const index = find_name(text, names);
+         if (index >= 0)
+            return static_cast<cron_int>(minval + index);
+
+         return to_cron_int(text);
       }
 
       static std::pair<cron_int, cron_int> make_range(
          std::string_view field,
          cron_int const minval,
-         cron_int const maxval)
+         cron_int const maxval,
+         cron_name_kind const names = cron_name_kind::none)
       {
          cron_int first = 0;
          cron_int last = 0;
@@ -299,17 +459,17 @@ namespace cron
          } 
          else if (!utils::contains(field, '-'))
          {
-            first = to_cron_int(field);
+            first = to_cron_value(field, minval, names);
             last = first;
          }
          else
          {
-            auto parts = utils::split(field, '-');
-            if (parts.size() != 2)
+            auto const dash = field.find('-');
+            if (dash + 1 == field.size() || field.find('-', dash + 1) != std::string_view::npos)
                throw bad_cronexpr("Specified range requires two fields");
 
-            first = to_cron_int(parts[0]);
-            last = to_cron_int(parts[1]);
+            first = to_cron_value(field.substr(0, dash), minval, names);
+            last = to_cron_value(field.substr(dash + 1), minval, names);
          }
 
          if (first > maxval || last > maxval)
@@ -328,25 +488,106 @@ namespace cron
          return { first, last };
       }
 
+      // Derives an independent value for each field from the job key hash.
+      constexpr inline std::uint64_t field_seed(std::uint64_t const key_hash, size_t const index) noexcept
+      {
+         auto value = key_hash + (index + 1) * 0x9e3779b97f4a7c15ull;
+         value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9ull;
+         value = (value ^ (value >> 27)) * 0x94d049bb133111ebull;
+         return value ^ (value >> 31);
+      }
+
+      // Range H picks from when no explicit range is given: the whole field,
+      // days 1-28 so that every month has the picked day, or none at all.
+      enum class cron_hash_range : std::uint8_t { full, common_days, explicit_only };
+
+      // Resolves H, H(a-b), H/n and H(a-b)/n to a range and an increment.
+      // H alone is one value of the field picked by the seed; with an
+      // increment, the seed picks the offset of the first value.
+      static std::tuple<cron_int, cron_int, cron_int> make_hashed_range(
+         std::string_view field,
+         cron_int const minval,
+         cron_int const maxval,
+         std::uint64_t const * const seed,
+         cron_name_kind const names,
+         cron_hash_range const implicit)
+      {
+         if (seed == nullptr)
+            throw bad_cronexpr("H requires a job key hash");
+
+         cron_int first = minval;
+         cron_int last = maxval;
+         cron_int pick_last = implicit == cron_hash_range::common_days ? std::min<cron_int>(maxval, 28) : maxval;
+
+         field.remove_prefix(1);
+         if (!field.empty() && field[0] == '(')
+         {
+            auto const close = field.find(')');
+            if (std::string_view::npos == close)
+               throw bad_cronexpr("Hash range must be enclosed in parentheses");
+
+            auto const range = field.substr(1, close - 1);
+            if (!utils::contains(range, '-'))
+               throw bad_cronexpr("Hash range requires two fields");
+
+            std::tie(first, last) = make_range(range, minval, maxval, names);
+            pick_last = last;
+            field.remove_prefix(close + 1);
+         }
+         else if (implicit == cron_hash_range::explicit_only)
+         {
+            throw bad_cronexpr("H requires an explicit range in this field");
+         }
+
+         cron_int delta = 0;
+         if (!field.empty())
+         {
+            if (field[0] != '/')
+               throw bad_cronexpr("Invalid hash expression");
+
+            delta = to_cron_int(field.substr(1));
+            if (delta <= 0)
+               throw bad_cronexpr("Incrementer must be a positive value");
+         }
+
+         auto const width = static_cast<std::uint64_t>(pick_last - first) + 1;
+         if (delta == 0)
+         {
+            auto const value = static_cast<cron_int>(first + *seed % width);
+            return { value, value, 1 };
+         }
+
+         auto const offset = *seed % std::min<std::uint64_t>(delta, width);
+         return { static_cast<cron_int>(first + offset), last, delta };
+      }
+
       template <size_t N>
       static void set_cron_field(
          std::string_view value,
          std::bitset<N>& target,
          cron_int const minval,
-         cron_int const maxval)
+         cron_int const maxval,
+         std::uint64_t const * const seed = nullptr,
+         cron_name_kind const names = cron_name_kind::none,
+         cron_hash_range const implicit = cron_hash_range::full)
       {
          if(value.length() > 0 && value[value.length()-1] == ',')
             throw bad_cronexpr("Value cannot end with comma");
 
-         auto fields = utils::split(value, ',');
-         if (fields.empty())
-            throw bad_cronexpr("Expression parsing error");
-
-         for (auto const & field : fields)
-         {
-            if (!utils::contains(field, '/'))
+         size_t count = 0;
+         utils::for_each_token(value, ',', [&](std::string_view const field) {
+            ++count;
+            if (!field.empty() && field[0] == 'H')
             {
-               auto[first, last] = detail::make_range(field, minval, maxval);
+               auto[first, last, delta] = detail::make_hashed_range(field, minval, maxval, seed, names, implicit);
+               for (cron_int i = first - minval; i <= last - minval; i += delta)
+               {
+                  target.set(i);
+               }
+            }
+            else if (!utils::contains(field, '/'))
+            {
+               auto[first, last] = detail::make_range(field, minval, maxval, names);
                for (cron_int i = first - minval; i <= last - minval; ++i)
                {
                   target.set(i);
@@ -354,18 +595,19 @@ namespace cron
             }
             else 
             {
-               auto parts = utils::split(field, '/');
-               if (parts.size() != 2)
+               auto const slash = field.find('/');
+               if (slash + 1 == field.size() || field.find('/', slash + 1) != std::string_view::npos)
                   throw bad_cronexpr("Incrementer must have two fields");
 
-               auto[first, last] = detail::make_range(parts[0], minval, maxval);
+               auto const range = field.substr(0, slash);
+               auto[first, last] = detail::make_range(range, minval, maxval, names);
 
-               if (!utils::contains(parts[0], '-'))
+               if (!utils::contains(range, '-'))
                {
                   last = maxval;
                }
 
-               auto delta = detail::to_cron_int(parts[1]);
+               auto delta = detail::to_cron_int(field.substr(slash + 1));
                if(delta <= 0)
                   throw bad_cronexpr("Incrementer must be a positive value");
 
@@ -374,71 +616,80 @@ namespace cron
                   target.set(i);
                }
             }
-         }
+         });
+
+         if (count == 0)
+            throw bad_cronexpr("Expression parsing error");
       }
 
       template <typename Traits>
       static void set_cron_days_of_week(
-         std::string value,
-         std::bitset<7>& target)
+         std::string_view value,
+         std::bitset<7>& target,
+         std::uint64_t const * const seed = nullptr)
       {
-         auto days = utils::to_upper(value);
-         auto days_replaced = detail::replace_ordinals(days, Traits::DAYS);
-
-         if (days_replaced.size() == 1 && days_replaced[0] == '?')
-            days_replaced[0] = '*';
+         if (value.size() == 1 && value[0] == '?')
+            value = "*";
 
          set_cron_field(
-            days_replaced, 
+            value, 
             target, 
             Traits::CRON_MIN_DAYS_OF_WEEK,
-            Traits::CRON_MAX_DAYS_OF_WEEK);         
+            Traits::CRON_MAX_DAYS_OF_WEEK,
+            seed,
+            cron_name_kind::day);
       }
 
       template <typename Traits>
       static void set_cron_days_of_month(
-         std::string value,
-         std::bitset<31>& target)
+         std::string_view value,
+         std::bitset<31>& target,
+         std::uint64_t const * const seed = nullptr)
       {
          if (value.size() == 1 && value[0] == '?')
-            value[0] = '*';
+            value = "*";
 
          set_cron_field(
             value, 
             target, 
             Traits::CRON_MIN_DAYS_OF_MONTH,
-            Traits::CRON_MAX_DAYS_OF_MONTH);
+            Traits::CRON_MAX_DAYS_OF_MONTH,
+            seed,
+            cron_name_kind::none,
+            cron_hash_range::common_days);
       }
 
       template <typename Traits>
       static void set_cron_month(
-         std::string value,
-         std::bitset<12>& target)
+         std::string_view value,
+         std::bitset<12>& target,
+         std::uint64_t const * const seed = nullptr)
       {
-         auto month = utils::to_upper(value);
-         auto month_replaced = replace_ordinals(month, Traits::MONTHS);
-
          set_cron_field(
-            month_replaced, 
+            value, 
             target, 
             Traits::CRON_MIN_MONTHS,
-            Traits::CRON_MAX_MONTHS);
+            Traits::CRON_MAX_MONTHS,
+            seed,
+            cron_name_kind::month);
       }
 
 	  template <typename Traits>
 	  static void set_cron_year(
-		  std::string value,
-		  std::bitset<130>& target)
+		  std::string_view value,
+		  std::bitset<130>& target,
+		  std::uint64_t const * const seed = nullptr)
 	  {
-		  auto year = utils::to_upper(value);
-
 		  if constexpr (Traits::CRON_USE_YEAR)
 		  {
 			  set_cron_field(
-				  year,
+				  value,
 				  target,
 				  Traits::CRON_MIN_YEARS,
-				  Traits::CRON_MAX_YEARS);
+				  Traits::CRON_MAX_YEARS,
+				  seed,
+				  cron_name_kind::none,
+				  cron_hash_range::explicit_only);
 		  }
 	  }
 
@@ -640,7 +891,7 @@ namespace cron
 		  unsigned int count = 0;
 		  unsigned int maximum = 130;
 		  while (
-			  (!years.test(year)) && year < maximum)
+			  year < maximum && !years.test(year))
 		  {
 			  add_to_field(date, cron_field::year, 1);
 
@@ -769,6 +1020,9 @@ namespace cron
 				 cex.years,
 				 year-Traits::CRON_MIN_YEARS,
 				 marked_fields) + Traits::CRON_MIN_YEARS;
+			 if (updated_year > Traits::CRON_MAX_YEARS)
+				 return false;
+
 			 if (year != updated_year)
 			 {
 				 res = find_next<Traits>(cex, date, dot);
@@ -797,46 +1051,79 @@ namespace cron
 		  else if constexpr (field == cron_field::year)
 			  return cex.years;
       }
+
+      template <cron_field field>
+      constexpr auto const & cron_field_ref(cronexpr const & cex)
+      {
+         return cron_field_ref<field>(const_cast<cronexpr&>(cex));
+      }
    }
 
-   template <typename Traits = cron_standard_traits>
-   static cronexpr make_cron(std::string_view expr)
+   namespace detail
    {
-      cronexpr cex;
+      template <typename Traits>
+      static cronexpr make_cron(std::string_view expr, std::uint64_t const * const key_hash)
+      {
+         cronexpr cex;
 
-      if (expr.empty())
-         throw bad_cronexpr("Invalid empty cron expression");
+         if (expr.empty())
+            throw bad_cronexpr("Invalid empty cron expression");
 
-      auto fields = utils::split(expr, ' ');
-      fields.erase(
-         std::remove_if(std::begin(fields), std::end(fields),
-            [](std::string_view s) {return s.empty(); }),
-         std::end(fields));
+         std::string_view fields[7];
+         size_t count = 0;
+         utils::for_each_token(expr, ' ', [&](std::string_view const field) {
+            if (field.empty()) return;
+            if (count < 7) fields[count] = field;
+            ++count;
+         });
 
-	  if constexpr (!Traits::CRON_USE_YEAR)
-	  {
-		  if (fields.size() != 6)
-			  throw bad_cronexpr("cron expression must have six fields");
-	  }
-	  else
-	  {
-		  if (fields.size() != 6 && fields.size() != 7)
-			  throw bad_cronexpr("cron expression must have six or seven fields");
-	  }
+         if constexpr (!Traits::CRON_USE_YEAR)
+         {
+            if (count != 6)
+               throw bad_cronexpr("cron expression must have six fields");
+         }
+         else
+         {
+            if (count != 6 && count != 7)
+               throw bad_cronexpr("cron expression must have six or seven fields");
+         }
+
+         std::uint64_t seeds[7] = {};
+         for (size_t i = 0; key_hash != nullptr && i < 7; ++i)
+            seeds[i] = field_seed(*key_hash, i);
+
+         auto const seed = [key_hash, &seeds](size_t const i) { return key_hash == nullptr ? nullptr : &seeds[i]; };
+
+         set_cron_field(fields[0], cron_field_ref<cron_field::second>(cex), Traits::CRON_MIN_SECONDS, Traits::CRON_MAX_SECONDS, seed(0));
+         set_cron_field(fields[1], cron_field_ref<cron_field::minute>(cex), Traits::CRON_MIN_MINUTES, Traits::CRON_MAX_MINUTES, seed(1));
+         set_cron_field(fields[2], cron_field_ref<cron_field::hour_of_day>(cex), Traits::CRON_MIN_HOURS, Traits::CRON_MAX_HOURS, seed(2));
+
+         set_cron_days_of_week<Traits>(fields[5], cron_field_ref<cron_field::day_of_week>(cex), seed(5));
 
-      detail::set_cron_field(fields[0], detail::cron_field_ref<detail::cron_field::second>(cex), Traits::CRON_MIN_SECONDS, Traits::CRON_MAX_SECONDS);
-      detail::set_cron_field(fields[1], detail::cron_field_ref<detail::cron_field::minute>(cex), Traits::CRON_MIN_MINUTES, Traits::CRON_MAX_MINUTES);
-      detail::set_cron_field(fields[2], detail::cron_field_ref<detail::cron_field::hour_of_day>(cex), Traits::CRON_MIN_HOURS, Traits::CRON_MAX_HOURS);
+         set_cron_days_of_month<Traits>(fields[3], cron_field_ref<cron_field::day_of_month>(cex), seed(3));
 
-      detail::set_cron_days_of_week<Traits>(fields[5], detail::cron_field_ref<detail::cron_field::day_of_week>(cex));
+         set_cron_month<Traits>(fields[4], cron_field_ref<cron_field::month>(cex), seed(4));
 
-      detail::set_cron_days_of_month<Traits>(fields[3], detail::cron_field_ref<detail::cron_field::day_of_month>(cex));
+         set_cron_year<Traits>((count == 7)?fields[6]:"*", cron_field_ref<cron_field::year>(cex), seed(6));
 
-      detail::set_cron_month<Traits>(fields[4], detail::cron_field_ref<detail::cron_field::month>(cex));
+         return cex;
+      }
+   }
 
-	  detail::set_cron_year<Traits>((fields.size() == 7)?fields[6]:"*", detail::cron_field_ref<detail::cron_field::year>(cex));
+   template <typename Traits = cron_standard_traits>
+   static cronexpr make_cron(std::string_view expr)
+   {
+      return detail::make_cron<Traits>(expr, nullptr);
+   }
 
-      return cex;
+   // Also accepts the H token (as in Jenkins) in any field: H, H(a-b), H/n
+   // and H(a-b)/n resolve to values derived from the key hash, so jobs with
+   // different keys spread over the field while each job keeps a fixed
+   // schedule. Use utils::hash_key() to hash a job name.
+   template <typename Traits = cron_standard_traits>
+   static cronexpr make_cron(std::string_view expr, std::uint64_t const key_hash)
+   {
+      return detail::make_cron<Traits>(expr, &key_hash);
    }
 
    template <typename Traits = cron_standard_traits>
@@ -0,0 +1,157 @@
+#pragma once
+
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <type_traits>
+
+#include "croncpp.h"
+
+namespace cron
+{
+   // Binary layout, all words little-endian:
+   //
+   //    offset  size  content
+   //         0     1  format version
+   //         1     1  dialect tag of the traits the expression was parsed with
+   //         2     8  seconds (bits 0-59)
+   //        10     8  minutes (bits 0-59)
+   //        18     3  hours (bits 0-23)
+   //        21     1  days of week (bits 0-6, Sunday first)
+   //        22     4  days of month (bits 0-30)
+   //        26     2  months (bits 0-11)
+   //        28    17  years (bits 0-129, from CRON_MIN_YEARS; quartz only)
+   constexpr std::uint8_t CRON_BINARY_VERSION = 1;
+   constexpr size_t CRON_BINARY_SIZE = 45;
+
+   using cron_binary = std::array<std::uint8_t, CRON_BINARY_SIZE>;
+
+   namespace detail
+   {
+      // 0 for traits defined outside this library.
+      template <typename Traits>
+      constexpr std::uint8_t dialect_tag() noexcept
+      {
+         if constexpr (std::is_same_v<Traits, cron_standard_traits>)
+            return 1;
+         else if constexpr (std::is_same_v<Traits, cron_oracle_traits>)
+            return 2;
+         else if constexpr (std::is_same_v<Traits, cron_quartz_traits>)
+            return 3;
+         else
+            return 0;
+      }
+
+      inline void store_le(std::uint8_t* out, std::uint64_t value, size_t const size) noexcept
+      {
+         for (size_t i = 0; i < size; ++i, value >>= 8)
+            out[i] = static_cast<std::uint8_t>(value);
+      }
+
+      inline std::uint64_t load_le(std::uint8_t const * in, size_t const size) noexcept
+      {
+         std::uint64_t value = 0;
+         for (size_t i = size; i > 0; --i)
+            value = (value << 8) | in[i - 1];
+         return value;
+      }
+
+      // Reads a field and checks that no bit above its range is set.
+      template <size_t N>
+      static std::bitset<N> load_field(std::uint8_t const * in, size_t const size)
+      {
+         auto const value = load_le(in, size);
+         if (N < 64 && (value >> N) != 0)
+            throw bad_cronexpr("Serialized field has bits out of range");
+         if (value == 0)
+            throw bad_cronexpr("Serialized field is empty");
+         return std::bitset<N>(value);
+      }
+   }
+
+   // Writes the CRON_BINARY_SIZE bytes of an expression to out.
+   template <typename Traits = cron_standard_traits>
+   static void cron_serialize(cronexpr const & cex, std::uint8_t* out) noexcept
+   {
+      using detail::cron_field;
+      using detail::cron_field_ref;
+
+      auto const & years = cron_field_ref<cron_field::year>(cex);
+      std::bitset<130> const low_word(~0ull);
+
+      out[0] = CRON_BINARY_VERSION;
+      out[1] = detail::dialect_tag<Traits>();
+      detail::store_le(out + 2, cron_field_ref<cron_field::second>(cex).to_ullong(), 8);
+      detail::store_le(out + 10, cron_field_ref<cron_field::minute>(cex).to_ullong(), 8);
+      detail::store_le(out + 18, cron_field_ref<cron_field::hour_of_day>(cex).to_ullong(), 3);
+      detail::store_le(out + 21, cron_field_ref<cron_field::day_of_week>(cex).to_ullong(), 1);
+      detail::store_le(out + 22, cron_field_ref<cron_field::day_of_month>(cex).to_ullong(), 4);
+      detail::store_le(out + 26, cron_field_ref<cron_field::month>(cex).to_ullong(), 2);
+      detail::store_le(out + 28, (years & low_word).to_ullong(), 8);
+      detail::store_le(out + 36, ((years >> 64) & low_word).to_ullong(), 8);
+      detail::store_le(out + 44, (years >> 128).to_ullong(), 1);
+   }
+
+   template <typename Traits = cron_standard_traits>
+   static cron_binary cron_serialize(cronexpr const & cex) noexcept
+   {
+      cron_binary result;
+      cron_serialize<Traits>(cex, result.data());
+      return result;
+   }
+
+   // Reads an expression written by cron_serialize() with the same traits.
+   // Throws bad_cronexpr if the size, version or dialect does not match, if a
+   // field is empty or if a bit outside the range of a field is set.
+   template <typename Traits = cron_standard_traits>
+   static cronexpr cron_deserialize(std::uint8_t const * data, size_t const size)
+   {
+      using detail::cron_field;
+      using detail::cron_field_ref;
+
+      if (size < CRON_BINARY_SIZE)
+         throw bad_cronexpr("Serialized expression is truncated");
+      if (data[0] != CRON_BINARY_VERSION)
+         throw bad_cronexpr("Unsupported serialization version");
+      if (data[1] != detail::dialect_tag<Traits>())
+         throw bad_cronexpr("Serialized expression was written for other traits");
+
+      cronexpr cex;
+      cron_field_ref<cron_field::second>(cex) = detail::load_field<60>(data + 2, 8);
+      cron_field_ref<cron_field::minute>(cex) = detail::load_field<60>(data + 10, 8);
+      cron_field_ref<cron_field::hour_of_day>(cex) = detail::load_field<24>(data + 18, 3);
+      cron_field_ref<cron_field::day_of_week>(cex) = detail::load_field<7>(data + 21, 1);
+      cron_field_ref<cron_field::day_of_month>(cex) = detail::load_field<31>(data + 22, 4);
+      cron_field_ref<cron_field::month>(cex) = detail::load_field<12>(data + 26, 2);
+
+      auto const high = detail::load_le(data + 44, 1);
+      if ((high >> 2) != 0)
+         throw bad_cronexpr("Serialized field has bits out of range");
+
+      auto & years = cron_field_ref<cron_field::year>(cex);
+      years = std::bitset<130>(high);
+      years <<= 64;
+      years |= std::bitset<130>(detail::load_le(data + 36, 8));
+      years <<= 64;
+      years |= std::bitset<130>(detail::load_le(data + 28, 8));
+
+      if constexpr (Traits::CRON_USE_YEAR)
+      {
+         if (years.none())
+            throw bad_cronexpr("Serialized field is empty");
+      }
+      else
+      {
+         if (years.any())
+            throw bad_cronexpr("Serialized expression has years its traits do not use");
+      }
+
+      return cex;
+   }
+
+   template <typename Traits = cron_standard_traits>
+   static cronexpr cron_deserialize(cron_binary const & data)
+   {
+      return cron_deserialize<Traits>(data.data(), data.size());
+   }
+}
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <exception>
+#include <iterator>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "croncpp.h"
+
+namespace cron
+{
+   struct parse_error
+   {
+      size_t      index;
+      std::string message;
+   };
+
+   namespace detail
+   {
+      constexpr size_t PARSE_BLOCK_SIZE = 4096;
+
+      template <typename Traits>
+      static size_t parse_block(
+         std::string_view const * exprs,
+         cronexpr* out,
+         size_t const first,
+         size_t const last,
+         std::vector<parse_error>& errors)
+      {
+         size_t parsed = 0;
+         for (size_t i = first; i < last; ++i)
+         {
+            try
+            {
+               out[i] = cron::make_cron<Traits>(exprs[i]);
+               ++parsed;
+            }
+            catch (std::exception const & ex)
+            {
+               out[i] = cronexpr{};
+               errors.push_back(parse_error{ i, ex.what() });
+            }
+         }
+         return parsed;
+      }
+   }
+
+   // Parses count expressions into out, on up to threads threads. Threads
+   // take blocks of PARSE_BLOCK_SIZE expressions in turn, so a block of
+   // expensive expressions does not hold the others back. No exception
+   // escapes: an expression that does not parse leaves an empty cronexpr in
+   // out and adds an entry to errors, which is sorted by index.
+   // Returns the number of expressions parsed.
+   template <typename Traits = cron_standard_traits>
+   static size_t parse_all(
+      std::string_view const * exprs,
+      size_t const count,
+      cronexpr* out,
+      std::vector<parse_error>& errors,
+      size_t threads = std::max(1u, std::thread::hardware_concurrency()))
+   {
+      auto const blocks = (count + detail::PARSE_BLOCK_SIZE - 1) / detail::PARSE_BLOCK_SIZE;
+      threads = std::min(std::max<size_t>(threads, 1), blocks);
+
+      if (threads <= 1)
+         return detail::parse_block<Traits>(exprs, out, 0, count, errors);
+
+      std::atomic<size_t> next_block{ 0 };
+      std::atomic<size_t> parsed{ 0 };
+      std::vector<std::vector<parse_error>> thread_errors(threads);
+      std::vector<std::thread> workers;
+
+      auto const work = [&](size_t const index) {
+         size_t done = 0;
+         for (auto block = next_block.fetch_add(1); block < blocks; block = next_block.fetch_add(1))
+         {
+            auto const first = block * detail::PARSE_BLOCK_SIZE;
+            auto const last = std::min(count, first + detail::PARSE_BLOCK_SIZE);
+            done += detail::parse_block<Traits>(exprs, out, first, last, thread_errors[index]);
+         }
+         parsed.fetch_add(done);
+      };
+
+      // blocks are shared through next_block, so when a thread cannot be
+      // started the ones running, and this one, parse its share
+      try
+      {
+         workers.reserve(threads - 1);
+         for (size_t i = 1; i < threads; ++i)
+            workers.emplace_back(work, i);
+      }
+      catch (std::exception const &)
+      {
+      }
+      work(0);
+
+      for (auto & t : workers)
+         t.join();
+
+      auto const start = errors.size();
+      for (auto & te : thread_errors)
+         std::move(te.begin(), te.end(), std::back_inserter(errors));
+      std::sort(errors.begin() + start, errors.end(),
+         [](parse_error const & a, parse_error const & b) { return a.index < b.index; });
+
+      return parsed.load();
+   }
+
+   template <typename Traits = cron_standard_traits>
+   static size_t parse_all(
+      std::vector<std::string_view> const & exprs,
+      std::vector<cronexpr>& out,
+      std::vector<parse_error>& errors,
+      size_t const threads = std::max(1u, std::thread::hardware_concurrency()))
+   {
+      out.resize(exprs.size());
+      return parse_all<Traits>(exprs.data(), exprs.size(), out.data(), errors, threads);
+   }
+}
@@ -0,0 +1,142 @@
+#pragma once
+
+#include <atomic>
+#include <functional>
+#include <iterator>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+#include "croncpp.h"
+
+namespace cron
+{
+   // Bounded, thread-safe cache of parsed expressions keyed by their text.
+   // Entries are spread over independently locked shards; lookups take a
+   // shared lock only, so concurrent hits never serialize. When a shard is
+   // full its oldest entry is evicted. Invalid expressions are not cached.
+   template <typename Traits = cron_standard_traits>
+   class cron_cache
+   {
+      struct entry
+      {
+         std::string text;
+         cronexpr    cex;
+      };
+
+      struct shard
+      {
+         mutable std::shared_mutex mutex;
+         std::list<entry> entries;
+         std::unordered_map<std::string_view, typename std::list<entry>::iterator> index;
+         std::atomic<size_t> hits{ 0 };
+         std::atomic<size_t> misses{ 0 };
+      };
+
+   public:
+      explicit cron_cache(size_t const capacity = 4096, size_t const shards = 16) :
+         shard_count(shards == 0 ? 1 : shards),
+         shard_capacity(capacity == 0 ? 0 : (capacity + shard_count - 1) / shard_count),
+         shards(std::make_unique<shard[]>(shard_count))
+      {
+      }
+
+      cron_cache(cron_cache const &) = delete;
+      cron_cache& operator=(cron_cache const &) = delete;
+
+      cronexpr get(std::string_view expr)
+      {
+         auto & s = shards[std::hash<std::string_view>{}(expr) % shard_count];
+
+         {
+            std::shared_lock<std::shared_mutex> lock(s.mutex);
+            auto it = s.index.find(expr);
+            if (it != s.index.end())
+            {
+               s.hits.fetch_add(1, std::memory_order_relaxed);
+               return it->second->cex;
+            }
+         }
+
+         s.misses.fetch_add(1, std::memory_order_relaxed);
+
+         auto cex = make_cron<Traits>(expr);
+         if (shard_capacity == 0) return cex;
+
+         std::unique_lock<std::shared_mutex> lock(s.mutex);
+         if (s.index.find(expr) == s.index.end())
+         {
+            s.entries.push_back(entry{ std::string(expr), cex });
+            auto last = std::prev(s.entries.end());
+            s.index.emplace(std::string_view(last->text), last);
+
+            if (s.entries.size() > shard_capacity)
+            {
+               s.index.erase(std::string_view(s.entries.front().text));
+               s.entries.pop_front();
+            }
+         }
+
+         return cex;
+      }
+
+      void clear()
+      {
+         for (size_t i = 0; i < shard_count; ++i)
+         {
+            std::unique_lock<std::shared_mutex> lock(shards[i].mutex);
+            shards[i].index.clear();
+            shards[i].entries.clear();
+         }
+      }
+
+      size_t size() const
+      {
+         size_t total = 0;
+         for (size_t i = 0; i < shard_count; ++i)
+         {
+            std::shared_lock<std::shared_mutex> lock(shards[i].mutex);
+            total += shards[i].entries.size();
+         }
+         return total;
+      }
+
+      size_t capacity() const noexcept
+      {
+         return shard_capacity * shard_count;
+      }
+
+      size_t hits() const noexcept
+      {
+         size_t total = 0;
+         for (size_t i = 0; i < shard_count; ++i)
+            total += shards[i].hits.load(std::memory_order_relaxed);
+         return total;
+      }
+
+      size_t misses() const noexcept
+      {
+         size_t total = 0;
+         for (size_t i = 0; i < shard_count; ++i)
+            total += shards[i].misses.load(std::memory_order_relaxed);
+         return total;
+      }
+
+   private:
+      size_t const shard_count;
+      size_t const shard_capacity;
+      std::unique_ptr<shard[]> shards;
+   };
+
+   // Not static: every translation unit must share the same cache instance.
+   template <typename Traits = cron_standard_traits>
+   cronexpr make_cron_cached(std::string_view expr)
+   {
+      static cron_cache<Traits> cache;
+      return cache.get(expr);
+   }
+}
@@ -0,0 +1,231 @@
+#pragma once
+
+// Coroutine support requires C++20; with older standards this header is empty.
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <chrono>
+#include <condition_variable>
+#include <coroutine>
+#include <cstdint>
+#include <ctime>
+#include <functional>
+#include <mutex>
+#include <queue>
+#include <thread>
+#include <vector>
+
+#include "croncpp.h"
+#include "croncpp_scheduler.h"
+
+namespace cron
+{
+   // One thread and one kernel timer serving any number of suspended
+   // coroutines. Coroutines are resumed on the timer thread, or handed to an
+   // executor (e.g. work_stealing_executor::dispatcher()) when one is set.
+   // Coroutines still suspended when the service is destroyed are not resumed.
+   class timer_service
+   {
+      struct entry
+      {
+         std::time_t             when;
+         std::uint64_t           sequence;
+         std::coroutine_handle<> handle;
+
+         bool operator>(entry const & other) const noexcept
+         {
+            return when != other.when ? when > other.when : sequence > other.sequence;
+         }
+      };
+
+   public:
+      using executor_hook = std::function<void(std::function<void()>)>;
+
+      timer_service() :
+         worker([this]() { run(); })
+      {}
+
+      ~timer_service()
+      {
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+         }
+         wakeup.notify_one();
+         worker.join();
+      }
+
+      timer_service(timer_service const &) = delete;
+      timer_service& operator=(timer_service const &) = delete;
+
+      static timer_service& instance()
+      {
+         static timer_service service;
+         return service;
+      }
+
+      void set_executor(executor_hook hook)
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         executor = std::move(hook);
+      }
+
+      void schedule(std::time_t const when, std::coroutine_handle<> handle)
+      {
+         bool earliest = false;
+         {
+            std::lock_guard<std::mutex> lock(mutex);
+            earliest = timers.empty() || when < timers.top().when;
+            timers.push(entry{ when, ++sequence, handle });
+         }
+
+         if (earliest) wakeup.notify_one();
+      }
+
+      size_t pending() const
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         return timers.size();
+      }
+
+   private:
+      void run()
+      {
+         std::vector<std::coroutine_handle<>> ready;
+
+         std::unique_lock<std::mutex> lock(mutex);
+         while (!stopping)
+         {
+            if (timers.empty())
+            {
+               wakeup.wait(lock);
+               continue;
+            }
+
+            auto const deadline = std::chrono::system_clock::from_time_t(timers.top().when);
+            if (std::chrono::system_clock::now() < deadline)
+            {
+               wakeup.wait_until(lock, deadline);
+               continue;
+            }
+
+            auto const now = wall_clock{}();
+            while (!timers.empty() && timers.top().when <= now)
+            {
+               ready.push_back(timers.top().handle);
+               timers.pop();
+            }
+
+            auto hook = executor;
+            lock.unlock();
+
+            for (auto handle : ready)
+            {
+               if (hook)
+                  hook([handle]() { handle.resume(); });
+               else
+                  handle.resume();
+            }
+            ready.clear();
+
+            lock.lock();
+         }
+      }
+
+      mutable std::mutex mutex;
+      std::condition_variable wakeup;
+      std::priority_queue<entry, std::vector<entry>, std::greater<entry>> timers;
+      std::uint64_t sequence = 0;
+      executor_hook executor;
+      bool stopping = false;
+      std::thread worker;
+   };
+
+   // Awaitable suspending until the first occurrence after a given moment.
+   // co_await yields that occurrence, or INVALID_TIME (without suspending)
+   // when the expression has no further occurrence.
+   template <typename Traits = cron_standard_traits>
+   class next_fire_awaiter
+   {
+   public:
+      next_fire_awaiter(cronexpr const & cex, std::time_t const after, timer_service& service) :
+         when(cron_next<Traits>(cex, after)),
+         service(&service)
+      {}
+
+      bool await_ready() const noexcept
+      {
+         return INVALID_TIME == when;
+      }
+
+      void await_suspend(std::coroutine_handle<> handle) const
+      {
+         service->schedule(when, handle);
+      }
+
+      std::time_t await_resume() const noexcept
+      {
+         return when;
+      }
+
+   private:
+      std::time_t    when;
+      timer_service* service;
+   };
+
+   template <typename Traits = cron_standard_traits>
+   next_fire_awaiter<Traits> next_fire(
+      cronexpr const & cex,
+      timer_service& service = timer_service::instance())
+   {
+      return next_fire_awaiter<Traits>(cex, wall_clock{}(), service);
+   }
+
+   // Asynchronous sequence of occurrences. Each co_await next() suspends
+   // until the occurrence following the previous one, so no occurrence is
+   // skipped even if the coroutine is resumed late.
+   //
+   //    cron::occurrences<> ticks(cex);
+   //    for (;;) { std::time_t when = co_await ticks.next(); ... }
+   template <typename Traits = cron_standard_traits>
+   class occurrences
+   {
+   public:
+      explicit occurrences(
+         cronexpr const & cex,
+         std::time_t const start = wall_clock{}(),
+         timer_service& service = timer_service::instance()) :
+         cex(cex),
+         last(start),
+         service(&service)
+      {}
+
+      auto next()
+      {
+         struct awaiter : next_fire_awaiter<Traits>
+         {
+            occurrences* owner;
+
+            awaiter(occurrences* o) :
+               next_fire_awaiter<Traits>(o->cex, o->last, *o->service),
+               owner(o)
+            {}
+
+            std::time_t await_resume() const noexcept
+            {
+               auto const when = next_fire_awaiter<Traits>::await_resume();
+               if (INVALID_TIME != when) owner->last = when;
+               return when;
+            }
+         };
+
+         return awaiter(this);
+      }
+
+   private:
+      cronexpr       cex;
+      std::time_t    last;
+      timer_service* service;
+   };
+}
+
+#endif
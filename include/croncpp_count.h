@@ -0,0 +1,786 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <bitset>
+#include <cstdint>
+#include <ctime>
+#include <limits>
+#include <utility>
+#include <vector>
+
+#include "croncpp.h"
+
+namespace cron
+{
+   namespace detail
+   {
+      struct civil_date
+      {
+         std::int64_t year;
+         unsigned     month;   // 1-12
+         unsigned     day;     // 1-31
+      };
+
+      // Days since 1970-01-01 in the proleptic Gregorian calendar, after
+      // Howard Hinnant's chrono-compatible date algorithms.
+      constexpr std::int64_t days_from_civil(std::int64_t year, unsigned const month, unsigned const day) noexcept
+      {
+         year -= month <= 2;
+         auto const era = (year >= 0 ? year : year - 399) / 400;
+         auto const yoe = static_cast<unsigned>(year - era * 400);
+         auto const doy = (153 * (month > 2 ? month - 3 : month + 9) + 2) / 5 + day - 1;
+         auto const doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+         return era * 146097 + static_cast<std::int64_t>(doe) - 719468;
+      }
+
+      constexpr civil_date civil_from_days(std::int64_t days) noexcept
+      {
+         days += 719468;
+         auto const era = (days >= 0 ? days : days - 146096) / 146097;
+         auto const doe = static_cast<unsigned>(days - era * 146097);
+         auto const yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+         auto const doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+         auto const mp = (5 * doy + 2) / 153;
+         auto const day = doy - (153 * mp + 2) / 5 + 1;
+         auto const month = mp < 10 ? mp + 3 : mp - 9;
+         return { static_cast<std::int64_t>(yoe) + era * 400 + (month <= 2), month, day };
+      }
+
+      // 0 is Sunday, as tm_wday.
+      constexpr unsigned weekday_from_days(std::int64_t const days) noexcept
+      {
+         return static_cast<unsigned>(days >= -4 ? (days + 4) % 7 : (days + 5) % 7 + 6);
+      }
+
+      constexpr unsigned days_in_month(std::int64_t const year, unsigned const month) noexcept
+      {
+         if (month != 2) return month == 4 || month == 6 || month == 9 || month == 11 ? 30 : 31;
+         return (year % 4 == 0 && year % 100 != 0) || year % 400 == 0 ? 29 : 28;
+      }
+
+      inline std::int64_t days_from_tm(std::tm const & tm) noexcept
+      {
+         return days_from_civil(tm.tm_year + 1900, static_cast<unsigned>(tm.tm_mon + 1), static_cast<unsigned>(tm.tm_mday));
+      }
+
+      // Local time of a civil date and time of day. In an hour repeated by a
+      // DST change, isdst picks the pass as for std::mktime().
+      inline std::time_t local_time(civil_date const & date, int const hour = 0, int const minute = 0, int const second = 0, int const isdst = -1)
+      {
+         std::tm tm{};
+         tm.tm_year = static_cast<int>(date.year - 1900);
+         tm.tm_mon = static_cast<int>(date.month) - 1;
+         tm.tm_mday = static_cast<int>(date.day);
+         tm.tm_hour = hour;
+         tm.tm_min = minute;
+         tm.tm_sec = second;
+         tm.tm_isdst = isdst;
+         return utils::tm_to_time(tm);
+      }
+
+      // INVALID_TIME when the hour is skipped by a DST transition.
+      inline std::time_t local_hour(civil_date const & date, int const hour)
+      {
+         auto const time = local_time(date, hour);
+
+         std::tm tm;
+         if (INVALID_TIME == time || utils::time_to_tm(&time, &tm) == nullptr || tm.tm_hour != hour)
+            return INVALID_TIME;
+
+         return time;
+      }
+
+      template <typename Traits>
+      static bool month_matches(cronexpr const & cex, std::int64_t const year, unsigned const month)
+      {
+         if (!cron_field_ref<cron_field::month>(cex).test(month - 1))
+            return false;
+
+         if constexpr (Traits::CRON_USE_YEAR)
+         {
+            if (year < Traits::CRON_MIN_YEARS || year > Traits::CRON_MAX_YEARS)
+               return false;
+            return cron_field_ref<cron_field::year>(cex).test(static_cast<size_t>(year - Traits::CRON_MIN_YEARS));
+         }
+
+         return true;
+      }
+
+      template <typename Traits>
+      static bool day_matches(cronexpr const & cex, civil_date const & date, unsigned const weekday)
+      {
+         return
+            cron_field_ref<cron_field::day_of_month>(cex).test(date.day - 1) &&
+            cron_field_ref<cron_field::day_of_week>(cex).test(weekday) &&
+            month_matches<Traits>(cex, date.year, date.month);
+      }
+
+      template <size_t N>
+      static std::vector<int> set_bits(std::bitset<N> const & bits)
+      {
+         std::vector<int> result;
+         for (size_t i = 0; i < N; ++i)
+         {
+            if (bits.test(i)) result.push_back(static_cast<int>(i));
+         }
+         return result;
+      }
+
+      // Number of bits set below the given position.
+      template <size_t N>
+      static size_t count_below(std::bitset<N> const & bits, size_t const position)
+      {
+         return position == 0 ? 0 : (bits << (N - std::min(position, N))).count();
+      }
+
+      // Occurrences within a matching day at or before a time of day.
+      static std::uint64_t count_time_of_day(cronexpr const & cex, std::tm const & tm)
+      {
+         auto const & hours = cron_field_ref<cron_field::hour_of_day>(cex);
+         auto const & minutes = cron_field_ref<cron_field::minute>(cex);
+         auto const & seconds = cron_field_ref<cron_field::second>(cex);
+
+         auto const hour = static_cast<size_t>(tm.tm_hour);
+         auto const minute = static_cast<size_t>(tm.tm_min);
+         auto const second = static_cast<size_t>(std::min(tm.tm_sec, 59));
+
+         std::uint64_t count = count_below(hours, hour) * minutes.count() * seconds.count();
+         if (hours.test(hour))
+         {
+            count += count_below(minutes, minute) * seconds.count();
+            if (minutes.test(minute))
+               count += count_below(seconds, second + 1);
+         }
+
+         return count;
+      }
+
+      // Matching days among day numbers. Each month costs one popcount: the
+      // days of month are masked with the days of the month whose weekday is
+      // allowed, which depend only on the weekday of the first of the month.
+      template <typename Traits>
+      class day_counter
+      {
+      public:
+         explicit day_counter(cronexpr const & cex) :
+            cex(cex),
+            days_of_month(static_cast<std::uint32_t>(cron_field_ref<cron_field::day_of_month>(cex).to_ulong()))
+         {
+            auto const & days_of_week = cron_field_ref<cron_field::day_of_week>(cex);
+            for (unsigned weekday = 0; weekday < 7; ++weekday)
+            {
+               for (unsigned day = 0; day < 31; ++day)
+               {
+                  if (days_of_week.test((weekday + day) % 7))
+                     weekday_masks[weekday] |= std::uint32_t(1) << day;
+               }
+            }
+         }
+
+         // Matching days among [first, last].
+         std::uint64_t count(std::int64_t first, std::int64_t const last) const
+         {
+            std::uint64_t total = 0;
+            while (first <= last)
+            {
+               auto const date = civil_from_days(first);
+               auto const month_last = first + (days_in_month(date.year, date.month) - date.day);
+               auto const end = std::min(last, month_last);
+
+               if (month_matches<Traits>(cex, date.year, date.month))
+               {
+                  // bits date.day - 1 to date.day - 1 + (end - first)
+                  auto const span = static_cast<unsigned>(end - first + 1);
+                  auto const range = (span >= 32 ? ~std::uint32_t(0) : ((std::uint32_t(1) << span) - 1)) << (date.day - 1);
+                  auto const weekday = weekday_from_days(first - (date.day - 1));
+                  total += std::bitset<32>(days_of_month & weekday_masks[weekday] & range).count();
+               }
+
+               first = month_last + 1;
+            }
+
+            return total;
+         }
+
+      private:
+         cronexpr const &              cex;
+         std::uint32_t const           days_of_month;
+         std::array<std::uint32_t, 7>  weekday_masks{};
+      };
+
+      template <typename Traits>
+      static std::uint64_t count_days(cronexpr const & cex, std::int64_t const first, std::int64_t const last)
+      {
+         return day_counter<Traits>(cex).count(first, last);
+      }
+
+      class forecast_window
+      {
+      public:
+         forecast_window(std::vector<std::uint64_t>& histogram, std::time_t const from, std::time_t const to, std::time_t const bucket) :
+            histogram(histogram), from(from), to(to), bucket(bucket)
+         {}
+
+         // Adds the fires of an interval when they all land in a single
+         // bucket (or outside the window). Returns false if the interval
+         // must be split.
+         bool add(std::time_t const start, std::time_t const length, std::uint64_t const fires) noexcept
+         {
+            if (start >= to || start + length <= from) return true;
+            if (start < from || start + length > to) return false;
+
+            auto const first = (start - from) / bucket;
+            if (first != (start + length - 1 - from) / bucket) return false;
+
+            histogram[static_cast<size_t>(first)] += fires;
+            return true;
+         }
+
+      private:
+         std::vector<std::uint64_t>& histogram;
+         std::time_t const from;
+         std::time_t const to;
+         std::time_t const bucket;
+      };
+   }
+
+   // Number of fires of a set of expressions in each bucket of the window
+   // [from, to); bucket i covers [from + i * bucket, from + (i + 1) * bucket).
+   // Only hours are counted in closed form: a matching hour that lies inside
+   // one bucket adds |minutes| * |seconds| in one step. Every hour does when
+   // buckets are multiples of an hour and from is on an hour boundary; an
+   // hour straddling buckets is split into its matching minutes, each adding
+   // |seconds| when it fits in one bucket. Buckets under an hour therefore
+   // cost one step per matching minute, and buckets under a minute (or not
+   // aligned to minutes) one step per fire, as much as enumerating the
+   // occurrences. Hours skipped by a DST transition have no fires and
+   // repeated ones are counted once, so on the day of a transition the
+   // histogram can differ from the fires of cron_next(), which cron_count()
+   // follows exactly. Returns an empty histogram for an empty window or a
+   // non-positive bucket width.
+   template <typename Traits = cron_standard_traits>
+   static std::vector<std::uint64_t> cron_forecast(
+      std::vector<cronexpr> const & expressions,
+      std::time_t const from,
+      std::time_t const to,
+      std::time_t const bucket)
+   {
+      if (to <= from || bucket <= 0) return {};
+
+      std::vector<std::uint64_t> histogram(static_cast<size_t>((to - from + bucket - 1) / bucket), 0);
+      detail::forecast_window window(histogram, from, to, bucket);
+
+      struct fields
+      {
+         std::vector<int> hours;
+         std::vector<int> minutes;
+         std::vector<int> seconds;
+      };
+
+      std::vector<fields> all_fields;
+      all_fields.reserve(expressions.size());
+      for (auto const & cex : expressions)
+      {
+         all_fields.push_back(fields{
+            detail::set_bits(detail::cron_field_ref<detail::cron_field::hour_of_day>(cex)),
+            detail::set_bits(detail::cron_field_ref<detail::cron_field::minute>(cex)),
+            detail::set_bits(detail::cron_field_ref<detail::cron_field::second>(cex)) });
+      }
+
+      std::tm first_tm;
+      std::tm last_tm;
+      auto const last = to - 1;
+      if (utils::time_to_tm(&from, &first_tm) == nullptr || utils::time_to_tm(&last, &last_tm) == nullptr)
+         return histogram;
+
+      auto const first_day = detail::days_from_tm(first_tm);
+      auto const last_day = detail::days_from_tm(last_tm);
+
+      auto midnight = detail::local_time(detail::civil_from_days(first_day));
+      for (auto day = first_day; day <= last_day; ++day)
+      {
+         auto const date = detail::civil_from_days(day);
+         auto const weekday = detail::weekday_from_days(day);
+         auto const next_midnight = detail::local_time(detail::civil_from_days(day + 1));
+
+         // on days with a DST transition every hour is converted separately
+         bool const regular = next_midnight - midnight == 86400;
+
+         for (size_t i = 0; i < expressions.size(); ++i)
+         {
+            if (!detail::day_matches<Traits>(expressions[i], date, weekday)) continue;
+
+            auto const & f = all_fields[i];
+            auto const per_hour = static_cast<std::uint64_t>(f.minutes.size() * f.seconds.size());
+
+            for (auto const h : f.hours)
+            {
+               auto const hour = regular ? midnight + h * 3600 : detail::local_hour(date, h);
+               if (INVALID_TIME == hour || window.add(hour, 3600, per_hour)) continue;
+
+               for (auto const m : f.minutes)
+               {
+                  auto const minute = hour + m * 60;
+                  if (window.add(minute, 60, f.seconds.size())) continue;
+
+                  for (auto const s : f.seconds)
+                     window.add(minute + s, 1, 1);
+               }
+            }
+         }
+
+         midnight = next_midnight;
+      }
+
+      return histogram;
+   }
+
+   namespace detail
+   {
+      // Occurrences in (from, to] counted on the local calendar as if no DST
+      // transition fell in between: matching days are counted per month
+      // with calendar masks and multiplied by |hours| * |minutes| *
+      // |seconds|; the partial first and last days are counted exactly from
+      // the bitsets.
+      template <typename Traits>
+      static std::uint64_t count_regular(cronexpr const & cex, std::time_t const from, std::time_t const to)
+      {
+         if (to <= from) return 0;
+
+         std::tm from_tm;
+         std::tm to_tm;
+         if (utils::time_to_tm(&from, &from_tm) == nullptr || utils::time_to_tm(&to, &to_tm) == nullptr)
+            return 0;
+
+         auto const first = days_from_tm(from_tm);
+         auto const last = days_from_tm(to_tm);
+
+         auto const matches = [&cex](std::int64_t const day) {
+            return day_matches<Traits>(cex, civil_from_days(day), weekday_from_days(day));
+         };
+
+         if (first == last)
+         {
+            if (!matches(first)) return 0;
+            return count_time_of_day(cex, to_tm) - count_time_of_day(cex, from_tm);
+         }
+
+         std::uint64_t const per_day =
+            cron_field_ref<cron_field::hour_of_day>(cex).count() *
+            cron_field_ref<cron_field::minute>(cex).count() *
+            cron_field_ref<cron_field::second>(cex).count();
+
+         std::uint64_t total = 0;
+         if (matches(first))
+            total += per_day - count_time_of_day(cex, from_tm);
+         if (matches(last))
+            total += count_time_of_day(cex, to_tm);
+         if (last - first > 1)
+            total += count_days<Traits>(cex, first + 1, last - 1) * per_day;
+
+         return total;
+      }
+
+      // Inverse of count_regular(): the n-th occurrence after the reference
+      // on the local calendar, or INVALID_TIME if there is none. Whole months
+      // are skipped with one popcount each, the day is then found by
+      // bisection within its month and the time of day by walking the hour,
+      // minute and second bitsets, so the cost grows with the number of
+      // months spanned. An occurrence on the day of the reference keeps its
+      // DST flag, so it stays in the same pass of a repeated hour.
+      template <typename Traits>
+      static std::time_t nth_regular(cronexpr const & cex, std::time_t const reference, std::uint64_t const n)
+      {
+         if (n == 0) return INVALID_TIME;
+
+         std::tm reference_tm;
+         if (utils::time_to_tm(&reference, &reference_tm) == nullptr)
+            return INVALID_TIME;
+
+         auto const & hours = cron_field_ref<cron_field::hour_of_day>(cex);
+         auto const & minutes = cron_field_ref<cron_field::minute>(cex);
+         auto const & seconds = cron_field_ref<cron_field::second>(cex);
+
+         std::uint64_t const per_minute = seconds.count();
+         std::uint64_t const per_hour = minutes.count() * per_minute;
+         std::uint64_t const per_day = hours.count() * per_hour;
+         if (per_day == 0) return INVALID_TIME;
+
+         auto const first = days_from_tm(reference_tm);
+         auto const skipped = count_time_of_day(cex, reference_tm);
+         bool const first_matches = day_matches<Traits>(cex, civil_from_days(first), weekday_from_days(first));
+
+         day_counter<Traits> const days(cex);
+
+         // occurrences after the reference up to the end of the day before low
+         std::uint64_t before = first_matches ? per_day - skipped : 0;
+         auto low = first;
+
+         // the calendar repeats every 400 years
+         constexpr std::int64_t horizon = 146097;
+
+         if (before < n)
+         {
+            for (auto day = first + 1; ; )
+            {
+               if (day - first > horizon) return INVALID_TIME;
+
+               auto const date = civil_from_days(day);
+               auto const month_last = day + (days_in_month(date.year, date.month) - date.day);
+               auto const in_month = days.count(day, month_last) * per_day;
+               if (before + in_month < n)
+               {
+                  before += in_month;
+                  day = month_last + 1;
+                  continue;
+               }
+
+               low = day;
+               auto high = month_last;
+               while (low < high)
+               {
+                  auto const middle = low + (high - low) / 2;
+                  if (before + days.count(day, middle) * per_day < n)
+                     low = middle + 1;
+                  else
+                     high = middle;
+               }
+
+               before += days.count(day, low - 1) * per_day;
+               break;
+            }
+         }
+
+         // position of the occurrence among the ones of its day
+         auto rank = low > first ? n - before : n + skipped;
+
+         for (size_t h = 0; h < hours.size(); ++h)
+         {
+            if (!hours.test(h)) continue;
+            if (rank > per_hour) { rank -= per_hour; continue; }
+
+            for (size_t m = 0; m < minutes.size(); ++m)
+            {
+               if (!minutes.test(m)) continue;
+               if (rank > per_minute) { rank -= per_minute; continue; }
+
+               for (size_t sec = 0; sec < seconds.size(); ++sec)
+               {
+                  if (seconds.test(sec) && --rank == 0)
+                  {
+                     return local_time(
+                        civil_from_days(low),
+                        static_cast<int>(h), static_cast<int>(m), static_cast<int>(sec),
+                        low == first ? reference_tm.tm_isdst : -1);
+                  }
+               }
+            }
+         }
+
+         return INVALID_TIME;
+      }
+
+      // Seconds the local time is ahead of UTC.
+      inline bool utc_offset(std::time_t const time, std::time_t& offset)
+      {
+         std::tm tm;
+         if (utils::time_to_tm(&time, &tm) == nullptr)
+            return false;
+
+         offset = static_cast<std::time_t>(days_from_tm(tm) * 86400 + tm.tm_hour * 3600 + tm.tm_min * 60 + tm.tm_sec) - time;
+         return true;
+      }
+
+      // The UTC offset is sampled this far apart. An offset that changes and
+      // changes back within one step goes unnoticed.
+      constexpr std::time_t TRANSITION_STEP = 7 * 86400;
+
+      // First moment in (time, limit] whose UTC offset differs from the one
+      // at time, or INVALID_TIME. The offset is sampled every
+      // TRANSITION_STEP seconds and the change located by bisection.
+      inline std::time_t next_transition(std::time_t const time, std::time_t const limit)
+      {
+         std::time_t offset;
+         if (!utc_offset(time, offset)) return INVALID_TIME;
+
+         for (auto low = time; low < limit; )
+         {
+            auto high = limit - low > TRANSITION_STEP ? low + TRANSITION_STEP : limit;
+
+            std::time_t probe;
+            if (!utc_offset(high, probe)) return INVALID_TIME;
+            if (probe == offset)
+            {
+               low = high;
+               continue;
+            }
+
+            while (high - low > 1)
+            {
+               auto const middle = low + (high - low) / 2;
+               if (!utc_offset(middle, probe)) return INVALID_TIME;
+               if (probe == offset)
+                  low = middle;
+               else
+                  high = middle;
+            }
+
+            return high;
+         }
+
+         return INVALID_TIME;
+      }
+
+      // The transitions after a starting moment, found on demand and kept,
+      // so that walks over the same range, like those of the jobs of one
+      // cron_catchup() batch, scan the time zone only once.
+      class transition_list
+      {
+      public:
+         explicit transition_list(std::time_t const from) :
+            scanned_from(from),
+            scanned_to(from)
+         {}
+
+         // First transition in (time, limit], or INVALID_TIME.
+         std::time_t next(std::time_t const time, std::time_t const limit)
+         {
+            if (time < scanned_from)
+            {
+               transitions.clear();
+               scanned_from = scanned_to = time;
+            }
+
+            while (scanned_to < limit && (transitions.empty() || transitions.back() <= time))
+            {
+               auto const transition = next_transition(scanned_to, limit);
+               if (INVALID_TIME == transition)
+               {
+                  scanned_to = limit;
+                  break;
+               }
+
+               transitions.push_back(transition);
+               scanned_to = transition;
+            }
+
+            auto const it = std::upper_bound(transitions.begin(), transitions.end(), time);
+            return it != transitions.end() && *it <= limit ? *it : INVALID_TIME;
+         }
+
+      private:
+         std::time_t              scanned_from;
+         std::time_t              scanned_to;
+         std::vector<std::time_t> transitions;
+      };
+
+      struct chain_position
+      {
+         std::uint64_t count = 0;             // fires walked
+         std::time_t   time = INVALID_TIME;   // the last of them
+      };
+
+      // Walks the fires cron_next() produces from a starting moment, up to
+      // the moment to or the n-th fire. cron_next() adjusts the broken-down
+      // time field by field, so around a DST transition it can skip fires
+      // or even step back. Stretches away from transitions are therefore
+      // counted in closed form and only the steps into the day of a
+      // transition and across the transition itself are taken with
+      // cron_next(). A cron_next() that does not advance ends the walk.
+      template <typename Traits>
+      static chain_position walk_chain(
+         cronexpr const & cex,
+         std::time_t time,
+         std::time_t const to,
+         std::uint64_t const n,
+         transition_list& transitions)
+      {
+         constexpr std::time_t time_max = std::numeric_limits<std::time_t>::max();
+         bool const bounded = n != std::numeric_limits<std::uint64_t>::max();
+
+         chain_position position;
+         while (position.count < n)
+         {
+            // the regular schedule is followed at most up to end
+            auto end = to;
+            if (bounded)
+            {
+               auto const nth = nth_regular<Traits>(cex, time, n - position.count);
+               if (INVALID_TIME == nth) return position;
+               end = std::min(end, nth);
+            }
+
+            // a transition late on the day after end still matters
+            auto const transition = transitions.next(time, end < time_max - 2 * 86400 ? end + 2 * 86400 : time_max);
+
+            auto regular_end = end;
+            if (INVALID_TIME != transition)
+            {
+               std::tm transition_tm;
+               if (utils::time_to_tm(&transition, &transition_tm) == nullptr)
+                  return position;
+
+               auto const midnight = local_time(civil_from_days(days_from_tm(transition_tm)));
+               regular_end = std::min(end, (time < midnight ? midnight : transition) - 1);
+            }
+
+            auto count = count_regular<Traits>(cex, time, regular_end);
+            if (bounded) count = std::min(count, n - position.count);
+            if (count > 0)
+            {
+               time = nth_regular<Traits>(cex, time, count);
+               position.count += count;
+               position.time = time;
+            }
+
+            if (position.count == n) break;
+
+            auto const next = cron_next<Traits>(cex, time);
+            if (INVALID_TIME == next || next == time || next > to) break;
+
+            time = next;
+            ++position.count;
+            position.time = time;
+         }
+
+         return position;
+      }
+   }
+
+   // Number of occurrences in (from, to], that is of the fires cron_next()
+   // produces when called repeatedly from from, counted without enumerating
+   // them (see detail::walk_chain()). The cost grows with the number of
+   // months and of DST transitions in the interval, plus one offset sample
+   // per detail::TRANSITION_STEP to find the transitions, not with the
+   // number of occurrences.
+   template <typename Traits = cron_standard_traits>
+   static std::uint64_t cron_count(cronexpr const & cex, std::time_t const from, std::time_t const to)
+   {
+      if (to <= from) return 0;
+
+      detail::transition_list transitions(from);
+      return detail::walk_chain<Traits>(cex, from, to, std::numeric_limits<std::uint64_t>::max(), transitions).count;
+   }
+
+   // Ordinal of an occurrence since a reference moment: 1 for the first
+   // occurrence after the reference, 2 for the second, and so on. For a
+   // moment that is not an occurrence, the ordinal of the last one before it.
+   template <typename Traits = cron_standard_traits>
+   static std::uint64_t cron_ordinal(cronexpr const & cex, std::time_t const reference, std::time_t const time)
+   {
+      return cron_count<Traits>(cex, reference, time);
+   }
+
+   // Inverse of cron_ordinal(): the n-th occurrence after the reference, or
+   // INVALID_TIME if there is none. Between DST transitions the occurrence
+   // is located with detail::nth_regular(), whose cost grows with the
+   // number of months spanned; each transition on the way adds one such
+   // search.
+   template <typename Traits = cron_standard_traits>
+   static std::time_t cron_nth(cronexpr const & cex, std::time_t const reference, std::uint64_t const n)
+   {
+      if (n == 0) return INVALID_TIME;
+
+      detail::transition_list transitions(reference);
+      auto const position = detail::walk_chain<Traits>(cex, reference, std::numeric_limits<std::time_t>::max(), n, transitions);
+      return position.count == n ? position.time : INVALID_TIME;
+   }
+
+   enum class catchup_policy
+   {
+      fire_all,    // run every missed occurrence
+      fire_once,   // run the latest missed occurrence only
+      skip         // run nothing, resume with the next occurrence
+   };
+
+   struct catchup_result
+   {
+      std::uint64_t            missed = 0;              // occurrences in (last_run, now]
+      std::time_t              latest = INVALID_TIME;   // the last of them
+      std::vector<std::time_t> fires;                   // the ones to run, per the policy
+   };
+
+   namespace detail
+   {
+      template <typename Traits>
+      static catchup_result catchup(
+         cronexpr const & cex,
+         std::time_t const last_run,
+         std::time_t const now,
+         catchup_policy const policy,
+         transition_list& transitions)
+      {
+         catchup_result result;
+         if (now <= last_run) return result;
+
+         auto const missed = walk_chain<Traits>(cex, last_run, now, std::numeric_limits<std::uint64_t>::max(), transitions);
+         if (missed.count == 0) return result;
+
+         result.missed = missed.count;
+         result.latest = missed.time;
+
+         switch (policy)
+         {
+         case catchup_policy::fire_all:
+            result.fires.reserve(static_cast<size_t>(result.missed));
+            for (auto t = last_run; result.fires.size() < result.missed; )
+            {
+               auto const next = walk_chain<Traits>(cex, t, std::numeric_limits<std::time_t>::max(), 1, transitions);
+               if (next.count == 0) break;
+               t = next.time;
+               result.fires.push_back(t);
+            }
+            break;
+         case catchup_policy::fire_once:
+            result.fires.push_back(result.latest);
+            break;
+         case catchup_policy::skip:
+            break;
+         }
+
+         return result;
+      }
+   }
+
+   // Missed occurrences of a job whose last run was at last_run. The count
+   // and the latest missed occurrence take one walk like cron_count(), so
+   // the cost grows with the number of months and DST transitions in
+   // (last_run, now], plus one offset sample per detail::TRANSITION_STEP of
+   // downtime to find the transitions. fire_all, which lists every
+   // occurrence, also grows with their number.
+   template <typename Traits = cron_standard_traits>
+   static catchup_result cron_catchup(
+      cronexpr const & cex,
+      std::time_t const last_run,
+      std::time_t const now,
+      catchup_policy const policy)
+   {
+      detail::transition_list transitions(last_run);
+      return detail::catchup<Traits>(cex, last_run, now, policy, transitions);
+   }
+
+   // Catch-up for a batch of (expression, last run) pairs. The DST
+   // transitions are found once for the whole batch, so each job only adds
+   // the months and transitions it walks.
+   template <typename Traits = cron_standard_traits>
+   static std::vector<catchup_result> cron_catchup(
+      std::vector<std::pair<cronexpr, std::time_t>> const & jobs,
+      std::time_t const now,
+      catchup_policy const policy)
+   {
+      std::vector<catchup_result> results;
+      results.reserve(jobs.size());
+      if (jobs.empty()) return results;
+
+      auto const first = std::min_element(jobs.begin(), jobs.end(), [](auto const & a, auto const & b) {
+         return a.second < b.second;
+      });
+      detail::transition_list transitions(first->second);
+
+      for (auto const & [cex, last_run] : jobs)
+         results.push_back(detail::catchup<Traits>(cex, last_run, now, policy, transitions));
+
+      return results;
+   }
+}
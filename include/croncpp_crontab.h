@@ -0,0 +1,265 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdio>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include "croncpp.h"
+
+namespace cron
+{
+   struct crontab_entry
+   {
+      cronexpr         cex;
+      std::string_view command;
+      size_t           line;
+   };
+
+   struct crontab_error
+   {
+      size_t           line;
+      std::string_view text;
+      std::string      message;
+   };
+
+   namespace detail
+   {
+      constexpr bool is_blank(char const ch) noexcept
+      {
+         return ch == ' ' || ch == '\t';
+      }
+
+      constexpr std::string_view skip_blanks(std::string_view text) noexcept
+      {
+         while (!text.empty() && is_blank(text.front()))
+            text.remove_prefix(1);
+         return text;
+      }
+
+      constexpr std::string_view next_token(std::string_view& text) noexcept
+      {
+         text = skip_blanks(text);
+
+         size_t length = 0;
+         while (length < text.size() && !is_blank(text[length]))
+            ++length;
+
+         auto const token = text.substr(0, length);
+         text.remove_prefix(length);
+         return token;
+      }
+
+      // Expressions of the @ shortcuts, with names so that they hold for
+      // every traits type.
+      constexpr std::string_view crontab_macro(std::string_view const name) noexcept
+      {
+         if (name == "@yearly" || name == "@annually") return "0 0 0 1 JAN *";
+         if (name == "@monthly") return "0 0 0 1 * *";
+         if (name == "@weekly") return "0 0 0 * * SUN";
+         if (name == "@daily" || name == "@midnight") return "0 0 0 * * *";
+         if (name == "@hourly") return "0 0 * * * *";
+         return {};
+      }
+
+      enum class crontab_line_kind { skip, schedule, error };
+
+      struct crontab_line
+      {
+         crontab_line_kind kind;
+         std::string_view  command;
+         std::string_view  message;
+      };
+
+      // Splits one line into its expression and command without parsing the
+      // expression. The expression is assembled in a buffer reused from line
+      // to line, so fields separated by tabs or several blanks reach
+      // make_cron() in the form it expects. line loses a trailing '\r'.
+      inline crontab_line split_crontab_line(std::string_view& line, size_t const fields, std::string& buffer)
+      {
+         if (!line.empty() && line.back() == '\r')
+            line.remove_suffix(1);
+
+         auto rest = skip_blanks(line);
+         if (rest.empty() || rest.front() == '#')
+            return { crontab_line_kind::skip, {}, {} };
+
+         auto const error = [](std::string_view const message) {
+            return crontab_line{ crontab_line_kind::error, {}, message };
+         };
+
+         // NAME=value or NAME = value
+         auto const name_end = rest.find_first_of(" \t=");
+         if (name_end != std::string_view::npos)
+         {
+            auto const after = skip_blanks(rest.substr(name_end));
+            if (!after.empty() && after.front() == '=')
+               return { crontab_line_kind::skip, {}, {} };
+         }
+
+         buffer.clear();
+         if (rest.front() == '@')
+         {
+            auto const name = next_token(rest);
+            auto const expr = crontab_macro(name);
+            if (expr.empty())
+               return error("Unsupported crontab macro");
+            buffer.append(expr);
+         }
+         else
+         {
+            // the classic five fields have no seconds
+            if (fields == 5) buffer.append("0");
+
+            for (size_t i = 0; i < fields; ++i)
+            {
+               auto const token = next_token(rest);
+               if (token.empty())
+                  return error("Too few fields in crontab line");
+
+               if (!buffer.empty()) buffer.push_back(' ');
+               buffer.append(token);
+            }
+         }
+
+         auto const command = skip_blanks(rest);
+         if (command.empty())
+            return error("Missing command in crontab line");
+
+         return { crontab_line_kind::schedule, command, {} };
+      }
+
+      template <typename Traits, typename OnEntry, typename OnError>
+      static bool read_crontab_line(
+         std::string_view line,
+         size_t const number,
+         size_t const fields,
+         std::string& buffer,
+         OnEntry& on_entry,
+         OnError& on_error)
+      {
+         auto const split = split_crontab_line(line, fields, buffer);
+         if (split.kind == crontab_line_kind::skip)
+            return false;
+
+         if (split.kind == crontab_line_kind::error)
+         {
+            on_error(crontab_error{ number, line, std::string(split.message) });
+            return false;
+         }
+
+         cronexpr cex;
+         try
+         {
+            cex = cron::make_cron<Traits>(buffer);
+         }
+         catch (bad_cronexpr const & ex)
+         {
+            on_error(crontab_error{ number, line, ex.what() });
+            return false;
+         }
+
+         on_entry(crontab_entry{ cex, split.command, number });
+         return true;
+      }
+   }
+
+   // Reads crontab lines from memory, e.g. a mapped file. Blank lines,
+   // comments and environment assignments are skipped; every schedule line
+   // is reported to on_entry with its command, and every invalid one to
+   // on_error. fields is the number of time fields of a schedule: 5 for the
+   // classic format (seconds are 0), 6 with seconds, or 7 with seconds and
+   // years for traits that use them. The @yearly, @annually, @monthly,
+   // @weekly, @daily, @midnight and @hourly shortcuts are accepted.
+   // The views passed to the callbacks point into text; error messages are
+   // owned by the error.
+   // Returns the number of entries.
+   template <typename Traits = cron_standard_traits, typename OnEntry, typename OnError>
+   static size_t read_crontab(std::string_view text, OnEntry&& on_entry, OnError&& on_error, size_t const fields = 5)
+   {
+      std::string buffer;
+      size_t entries = 0;
+
+      for (size_t number = 1; !text.empty(); ++number)
+      {
+         auto const end = text.find('\n');
+         auto const line = text.substr(0, end);
+         text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+         if (detail::read_crontab_line<Traits>(line, number, fields, buffer, on_entry, on_error))
+            ++entries;
+      }
+
+      return entries;
+   }
+
+   // Reads a crontab file in chunks of chunk_size bytes; only a line
+   // straddling two chunks is copied. The views passed to the callbacks are
+   // only valid during the call. Throws std::system_error if the file cannot
+   // be read.
+   template <typename Traits = cron_standard_traits, typename OnEntry, typename OnError>
+   static size_t read_crontab_file(
+      std::string const & path,
+      OnEntry&& on_entry,
+      OnError&& on_error,
+      size_t const fields = 5,
+      size_t const chunk_size = 65536)
+   {
+      std::FILE* file = std::fopen(path.c_str(), "rb");
+      if (file == nullptr)
+         throw std::system_error(errno, std::generic_category(), "opening crontab failed");
+
+      struct closer
+      {
+         std::FILE* file;
+         ~closer() { std::fclose(file); }
+      } const close_file{ file };
+
+      std::vector<char> chunk(chunk_size == 0 ? 1 : chunk_size);
+      std::string carry;
+      std::string buffer;
+      size_t entries = 0;
+      size_t number = 0;
+
+      auto const line = [&](std::string_view const text) {
+         if (detail::read_crontab_line<Traits>(text, ++number, fields, buffer, on_entry, on_error))
+            ++entries;
+      };
+
+      for (;;)
+      {
+         auto const read = std::fread(chunk.data(), 1, chunk.size(), file);
+         if (read == 0)
+         {
+            if (std::ferror(file))
+               throw std::system_error(EIO, std::generic_category(), "reading crontab failed");
+            break;
+         }
+
+         std::string_view text(chunk.data(), read);
+         for (auto end = text.find('\n'); end != std::string_view::npos; end = text.find('\n'))
+         {
+            if (carry.empty())
+            {
+               line(text.substr(0, end));
+            }
+            else
+            {
+               carry.append(text.substr(0, end));
+               line(carry);
+               carry.clear();
+            }
+            text.remove_prefix(end + 1);
+         }
+
+         carry.append(text);
+      }
+
+      if (!carry.empty())
+         line(carry);
+
+      return entries;
+   }
+}
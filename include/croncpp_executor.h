@@ -0,0 +1,437 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace cron
+{
+   namespace detail
+   {
+      struct executor_task
+      {
+         std::function<void()> fn;
+         std::chrono::steady_clock::time_point submitted;
+         bool timed = false;
+         std::chrono::system_clock::time_point fired{};
+      };
+
+      // Chase-Lev work-stealing deque (Le, Pop, Cohen, Zappa Nardelli, 2013).
+      // Only the owning worker pushes and pops at the bottom; any thread may
+      // steal from the top. Retired buffers are kept until destruction since
+      // a thief may still be reading from them.
+      class chase_lev_deque
+      {
+         struct ring
+         {
+            explicit ring(std::int64_t const size) :
+               capacity(size),
+               items(std::make_unique<std::atomic<executor_task*>[]>(static_cast<size_t>(size)))
+            {}
+
+            executor_task* get(std::int64_t const index) const noexcept
+            {
+               return items[static_cast<size_t>(index & (capacity - 1))].load(std::memory_order_relaxed);
+            }
+
+            void put(std::int64_t const index, executor_task* item) noexcept
+            {
+               items[static_cast<size_t>(index & (capacity - 1))].store(item, std::memory_order_relaxed);
+            }
+
+            std::int64_t const capacity;
+            std::unique_ptr<std::atomic<executor_task*>[]> items;
+         };
+
+      public:
+         explicit chase_lev_deque(std::int64_t const capacity = 256)
+         {
+            rings.push_back(std::make_unique<ring>(capacity));
+            buffer.store(rings.back().get(), std::memory_order_relaxed);
+         }
+
+         chase_lev_deque(chase_lev_deque const &) = delete;
+         chase_lev_deque& operator=(chase_lev_deque const &) = delete;
+
+         void push(executor_task* item)
+         {
+            auto const b = bottom.load(std::memory_order_relaxed);
+            auto const t = top.load(std::memory_order_acquire);
+            auto* a = buffer.load(std::memory_order_relaxed);
+
+            if (b - t > a->capacity - 1)
+               a = grow(a, t, b);
+
+            a->put(b, item);
+            bottom.store(b + 1, std::memory_order_release);
+         }
+
+         executor_task* pop()
+         {
+            auto const b = bottom.load(std::memory_order_relaxed) - 1;
+            auto* a = buffer.load(std::memory_order_relaxed);
+            bottom.store(b, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto t = top.load(std::memory_order_relaxed);
+
+            executor_task* item = nullptr;
+            if (t <= b)
+            {
+               item = a->get(b);
+               if (t == b)
+               {
+                  if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+                     item = nullptr;
+                  bottom.store(b + 1, std::memory_order_relaxed);
+               }
+            }
+            else
+            {
+               bottom.store(b + 1, std::memory_order_relaxed);
+            }
+
+            return item;
+         }
+
+         executor_task* steal()
+         {
+            auto t = top.load(std::memory_order_acquire);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto const b = bottom.load(std::memory_order_acquire);
+
+            if (t >= b) return nullptr;
+
+            auto* a = buffer.load(std::memory_order_acquire);
+            auto* item = a->get(t);
+            if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+               return nullptr;
+
+            return item;
+         }
+
+         size_t size() const noexcept
+         {
+            auto const b = bottom.load(std::memory_order_relaxed);
+            auto const t = top.load(std::memory_order_relaxed);
+            return b > t ? static_cast<size_t>(b - t) : 0;
+         }
+
+      private:
+         ring* grow(ring* old, std::int64_t const t, std::int64_t const b)
+         {
+            rings.push_back(std::make_unique<ring>(old->capacity * 2));
+            auto* a = rings.back().get();
+            for (auto i = t; i < b; ++i)
+               a->put(i, old->get(i));
+
+            buffer.store(a, std::memory_order_release);
+            return a;
+         }
+
+         alignas(64) std::atomic<std::int64_t> top{ 0 };
+         alignas(64) std::atomic<std::int64_t> bottom{ 0 };
+         std::atomic<ring*> buffer{ nullptr };
+         std::vector<std::unique_ptr<ring>> rings;
+      };
+   }
+
+   struct executor_stats
+   {
+      size_t                   workers = 0;
+      size_t                   queue_depth = 0;
+      std::uint64_t            executed = 0;
+      std::uint64_t            failed = 0;           // executed tasks that threw
+      std::uint64_t            steals = 0;
+      std::chrono::nanoseconds total_wait{ 0 };      // from submission to start
+      std::chrono::nanoseconds max_wait{ 0 };
+      std::uint64_t            timed = 0;            // tasks submitted with a fire time
+      std::chrono::nanoseconds total_latency{ 0 };   // from the fire time to start
+      std::chrono::nanoseconds max_latency{ 0 };
+   };
+
+   // Thread pool executing fired job callbacks. Each worker owns a Chase-Lev
+   // deque; idle workers steal from the others. Tasks submitted from outside
+   // the pool are handed round-robin to per-worker inboxes; tasks submitted by
+   // a running task go straight to the deque of its worker.
+   // The wait reported in the statistics is the time from submission to the
+   // moment a worker starts running the task. Tasks of fired jobs also carry
+   // the fire time, passed by the scheduler through dispatcher(), and their
+   // latency is measured from it, so it includes the time spent before
+   // submission, e.g. after a late tick. An exception thrown by a task is
+   // caught and counted as a failure; the worker carries on.
+   class work_stealing_executor
+   {
+      struct alignas(64) worker
+      {
+         detail::chase_lev_deque               tasks;
+         std::mutex                            inbox_mutex;
+         std::deque<detail::executor_task*>    inbox;
+         std::atomic<size_t>                   inbox_size{ 0 };
+
+         std::atomic<std::uint64_t>            executed{ 0 };
+         std::atomic<std::uint64_t>            failed{ 0 };
+         std::atomic<std::uint64_t>            steals{ 0 };
+         std::atomic<std::int64_t>             total_wait{ 0 };
+         std::atomic<std::int64_t>             max_wait{ 0 };
+         std::atomic<std::uint64_t>            timed{ 0 };
+         std::atomic<std::int64_t>             total_latency{ 0 };
+         std::atomic<std::int64_t>             max_latency{ 0 };
+
+         std::thread                           thread;
+      };
+
+   public:
+      // Submits to the executor. Called with a task, or with the task of a
+      // fired job and its fire time.
+      class dispatch_adapter
+      {
+      public:
+         explicit dispatch_adapter(work_stealing_executor& pool) : pool(&pool) {}
+
+         void operator()(std::function<void()> fn) const
+         {
+            pool->submit(std::move(fn));
+         }
+
+         void operator()(std::function<void()> fn, std::time_t const fire_time) const
+         {
+            pool->submit(std::move(fn), fire_time);
+         }
+
+      private:
+         work_stealing_executor* pool;
+      };
+
+      explicit work_stealing_executor(size_t const workers = std::max(1u, std::thread::hardware_concurrency()))
+      {
+         auto const count = std::max<size_t>(1, workers);
+         for (size_t i = 0; i < count; ++i)
+            all_workers.push_back(std::make_unique<worker>());
+
+         for (size_t i = 0; i < count; ++i)
+            all_workers[i]->thread = std::thread([this, i]() { run(i); });
+      }
+
+      // Runs every task already submitted before returning.
+      ~work_stealing_executor()
+      {
+         {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            stopping.store(true);
+         }
+         sleep_cv.notify_all();
+
+         for (auto & w : all_workers)
+            w->thread.join();
+      }
+
+      work_stealing_executor(work_stealing_executor const &) = delete;
+      work_stealing_executor& operator=(work_stealing_executor const &) = delete;
+
+      void submit(std::function<void()> fn)
+      {
+         enqueue(new detail::executor_task{ std::move(fn), std::chrono::steady_clock::now() });
+      }
+
+      // Submits the callback of a job that fired at fire_time.
+      void submit(std::function<void()> fn, std::time_t const fire_time)
+      {
+         enqueue(new detail::executor_task{
+            std::move(fn), std::chrono::steady_clock::now(), true, std::chrono::system_clock::from_time_t(fire_time) });
+      }
+
+      // Adapter for scheduler::set_dispatcher() and
+      // timer_service::set_executor().
+      dispatch_adapter dispatcher()
+      {
+         return dispatch_adapter(*this);
+      }
+
+      size_t workers() const noexcept
+      {
+         return all_workers.size();
+      }
+
+      executor_stats stats() const
+      {
+         executor_stats result;
+         result.workers = all_workers.size();
+         result.queue_depth = pending.load(std::memory_order_relaxed);
+
+         for (auto const & w : all_workers)
+         {
+            result.executed += w->executed.load(std::memory_order_relaxed);
+            result.failed += w->failed.load(std::memory_order_relaxed);
+            result.steals += w->steals.load(std::memory_order_relaxed);
+            result.total_wait += std::chrono::nanoseconds(w->total_wait.load(std::memory_order_relaxed));
+            result.max_wait = std::max(result.max_wait, std::chrono::nanoseconds(w->max_wait.load(std::memory_order_relaxed)));
+            result.timed += w->timed.load(std::memory_order_relaxed);
+            result.total_latency += std::chrono::nanoseconds(w->total_latency.load(std::memory_order_relaxed));
+            result.max_latency = std::max(result.max_latency, std::chrono::nanoseconds(w->max_latency.load(std::memory_order_relaxed)));
+         }
+
+         return result;
+      }
+
+   private:
+      void enqueue(detail::executor_task* item)
+      {
+         pending.fetch_add(1, std::memory_order_seq_cst);
+
+         if (current_executor == this)
+         {
+            all_workers[current_worker]->tasks.push(item);
+         }
+         else
+         {
+            auto & w = *all_workers[next_worker.fetch_add(1, std::memory_order_relaxed) % all_workers.size()];
+            std::lock_guard<std::mutex> lock(w.inbox_mutex);
+            w.inbox.push_back(item);
+            w.inbox_size.fetch_add(1, std::memory_order_relaxed);
+         }
+
+         if (sleeping.load(std::memory_order_seq_cst) > 0)
+         {
+            { std::lock_guard<std::mutex> lock(sleep_mutex); }
+            sleep_cv.notify_one();
+         }
+      }
+
+      static void record(std::atomic<std::int64_t>& total, std::atomic<std::int64_t>& max, std::int64_t const value)
+      {
+         total.fetch_add(value, std::memory_order_relaxed);
+         if (value > max.load(std::memory_order_relaxed))
+            max.store(value, std::memory_order_relaxed);
+      }
+
+      detail::executor_task* take_inbox(worker& w, bool const all)
+      {
+         if (w.inbox_size.load(std::memory_order_relaxed) == 0) return nullptr;
+
+         std::unique_lock<std::mutex> lock(w.inbox_mutex, std::try_to_lock);
+         if (!lock.owns_lock() || w.inbox.empty()) return nullptr;
+
+         auto* item = w.inbox.front();
+         w.inbox.pop_front();
+         w.inbox_size.fetch_sub(1, std::memory_order_relaxed);
+
+         if (all)
+         {
+            for (auto* other : w.inbox)
+               w.tasks.push(other);
+            w.inbox_size.fetch_sub(w.inbox.size(), std::memory_order_relaxed);
+            w.inbox.clear();
+         }
+
+         return item;
+      }
+
+      detail::executor_task* find_task(size_t const index)
+      {
+         auto & self = *all_workers[index];
+
+         if (auto* item = self.tasks.pop()) return item;
+         if (auto* item = take_inbox(self, true)) return item;
+
+         auto const count = all_workers.size();
+         for (size_t i = 1; i < count; ++i)
+         {
+            auto & victim = *all_workers[(index + i) % count];
+            auto* item = victim.tasks.steal();
+            if (item == nullptr) item = take_inbox(victim, false);
+            if (item != nullptr)
+            {
+               self.steals.fetch_add(1, std::memory_order_relaxed);
+               return item;
+            }
+         }
+
+         return nullptr;
+      }
+
+      void execute(worker& w, detail::executor_task* item)
+      {
+         pending.fetch_sub(1, std::memory_order_relaxed);
+
+         auto const wait = std::chrono::duration_cast<std::chrono::nanoseconds>(
+            std::chrono::steady_clock::now() - item->submitted).count();
+         record(w.total_wait, w.max_wait, wait);
+
+         if (item->timed)
+         {
+            // the fire time is on the wall clock; a clock set back gives 0
+            auto const latency = std::chrono::duration_cast<std::chrono::nanoseconds>(
+               std::chrono::system_clock::now() - item->fired).count();
+            record(w.total_latency, w.max_latency, std::max<std::int64_t>(0, latency));
+            w.timed.fetch_add(1, std::memory_order_relaxed);
+         }
+
+         std::unique_ptr<detail::executor_task> owned(item);
+         try
+         {
+            owned->fn();
+         }
+         catch (...)
+         {
+            // an escaping exception would terminate the process
+            w.failed.fetch_add(1, std::memory_order_relaxed);
+         }
+
+         w.executed.fetch_add(1, std::memory_order_relaxed);
+      }
+
+      void run(size_t const index)
+      {
+         current_executor = this;
+         current_worker = index;
+
+         auto & self = *all_workers[index];
+
+         for (;;)
+         {
+            if (auto* item = find_task(index))
+            {
+               execute(self, item);
+               continue;
+            }
+
+            if (pending.load(std::memory_order_seq_cst) > 0)
+            {
+               std::this_thread::yield();
+               continue;
+            }
+
+            std::unique_lock<std::mutex> lock(sleep_mutex);
+            sleeping.fetch_add(1, std::memory_order_seq_cst);
+            sleep_cv.wait(lock, [this]() {
+               return pending.load(std::memory_order_seq_cst) > 0 || stopping.load();
+            });
+            sleeping.fetch_sub(1, std::memory_order_seq_cst);
+
+            if (stopping.load() && pending.load(std::memory_order_seq_cst) == 0)
+               return;
+         }
+      }
+
+      static inline thread_local work_stealing_executor* current_executor = nullptr;
+      static inline thread_local size_t current_worker = 0;
+
+      std::vector<std::unique_ptr<worker>> all_workers;
+      std::atomic<size_t> next_worker{ 0 };
+
+      alignas(64) std::atomic<size_t> pending{ 0 };
+      alignas(64) std::atomic<size_t> sleeping{ 0 };
+      std::atomic<bool> stopping{ false };
+      std::mutex sleep_mutex;
+      std::condition_variable sleep_cv;
+   };
+}
@@ -0,0 +1,428 @@
+#pragma once
+
+// POSIX only: the journal is written with write() and fsync().
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <cerrno>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "croncpp_snapshot.h"
+
+namespace cron
+{
+   // Journal file layout, all words little-endian. A 16-byte header:
+   //
+   //    offset  size  content
+   //         0     8  magic "CRONJRNL"
+   //         8     4  format version
+   //        12     4  record size (24)
+   //
+   // followed by one 24-byte record per fire, in the order they committed:
+   //
+   //         0     8  job identifier
+   //         8     8  occurrence time
+   //        16     8  FNV-1a hash of the first 16 bytes
+   //
+   // A crash can leave a torn record at the end; reading stops at the first
+   // record whose hash does not match.
+   constexpr std::uint32_t CRON_JOURNAL_VERSION = 1;
+   constexpr size_t CRON_JOURNAL_HEADER_SIZE = 16;
+   constexpr size_t CRON_JOURNAL_RECORD_SIZE = 24;
+
+   using fire_times = std::unordered_map<std::uint64_t, std::time_t>;
+
+   struct journal_options
+   {
+      // How long records may wait in memory before they are written and
+      // flushed to disk, by a background thread if no record() comes. 0 makes
+      // record() return only once its record is durable.
+      std::chrono::milliseconds sync_interval{ 0 };
+
+      // Records waiting in memory that force a commit.
+      size_t max_batch = 1024;
+   };
+
+   namespace detail
+   {
+      constexpr char JOURNAL_MAGIC[8] = { 'C', 'R', 'O', 'N', 'J', 'R', 'N', 'L' };
+
+      inline std::uint64_t journal_check(std::uint8_t const * record) noexcept
+      {
+         return utils::hash_key(std::string_view(reinterpret_cast<char const *>(record), 16));
+      }
+
+      inline void append_journal_record(std::vector<std::uint8_t>& out, std::uint64_t const id, std::time_t const time)
+      {
+         auto const offset = out.size();
+         out.resize(offset + CRON_JOURNAL_RECORD_SIZE);
+         store_le(out.data() + offset, id, 8);
+         store_le(out.data() + offset + 8, static_cast<std::uint64_t>(time), 8);
+         store_le(out.data() + offset + 16, journal_check(out.data() + offset), 8);
+      }
+
+      inline std::vector<std::uint8_t> journal_header()
+      {
+         std::vector<std::uint8_t> header(CRON_JOURNAL_HEADER_SIZE);
+         std::memcpy(header.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC));
+         store_le(header.data() + 8, CRON_JOURNAL_VERSION, 4);
+         store_le(header.data() + 12, CRON_JOURNAL_RECORD_SIZE, 4);
+         return header;
+      }
+
+      // Reads the records of an open journal into the latest fire time of
+      // every job. Returns the length of the valid part of the file.
+      inline size_t scan_journal(int const fd, fire_times& last)
+      {
+         std::vector<std::uint8_t> buffer(CRON_JOURNAL_RECORD_SIZE * 16384);
+         size_t filled = 0;
+         size_t valid = 0;
+         bool header = true;
+
+         for (;;)
+         {
+            auto const count = ::pread(fd, buffer.data() + filled, buffer.size() - filled, static_cast<off_t>(valid + filled));
+            if (count < 0)
+            {
+               if (errno == EINTR) continue;
+               throw std::system_error(errno, std::generic_category(), "reading journal failed");
+            }
+            filled += static_cast<size_t>(count);
+
+            size_t offset = 0;
+            if (header && filled >= CRON_JOURNAL_HEADER_SIZE)
+            {
+               if (std::memcmp(buffer.data(), JOURNAL_MAGIC, sizeof(JOURNAL_MAGIC)) != 0)
+                  throw std::runtime_error("Not a journal file");
+               if (load_le(buffer.data() + 8, 4) != CRON_JOURNAL_VERSION)
+                  throw std::runtime_error("Unsupported journal version");
+               if (load_le(buffer.data() + 12, 4) != CRON_JOURNAL_RECORD_SIZE)
+                  throw std::runtime_error("Unsupported journal record size");
+               offset = CRON_JOURNAL_HEADER_SIZE;
+               header = false;
+            }
+
+            for (; !header && offset + CRON_JOURNAL_RECORD_SIZE <= filled; offset += CRON_JOURNAL_RECORD_SIZE)
+            {
+               auto const * record = buffer.data() + offset;
+               if (load_le(record + 16, 8) != journal_check(record))
+                  return valid + offset;
+
+               auto const id = load_le(record, 8);
+               auto const time = static_cast<std::time_t>(load_le(record + 8, 8));
+               auto [it, inserted] = last.emplace(id, time);
+               if (!inserted && time > it->second)
+                  it->second = time;
+            }
+
+            if (count == 0)
+               return header ? 0 : valid + offset;
+
+            std::memmove(buffer.data(), buffer.data() + offset, filled - offset);
+            valid += offset;
+            filled -= offset;
+         }
+      }
+   }
+
+   // Reads a journal and returns the latest recorded fire time of every job,
+   // e.g. to resume a job from cron_next() of that time or to pass it to
+   // cron_catchup(). Throws std::system_error if the file cannot be read and
+   // std::runtime_error if it is not a journal.
+   inline fire_times replay_journal(std::string const & path)
+   {
+      int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+      if (fd < 0)
+         throw std::system_error(errno, std::generic_category(), "opening journal failed");
+
+      fire_times last;
+      try
+      {
+         detail::scan_journal(fd, last);
+      }
+      catch (...)
+      {
+         ::close(fd);
+         throw;
+      }
+
+      ::close(fd);
+      return last;
+   }
+
+   // Append-only journal of fired occurrences. Opening it replays the
+   // existing records and cuts off a torn tail; a file shorter than the
+   // header, left by a crash while it was created, is started over.
+   // record() is thread-safe: records appended while a commit is in progress
+   // are written and flushed together by the next commit, so concurrent
+   // fires share one fsync(). With a sync interval, a flusher thread commits
+   // records that have waited that long.
+   class fire_journal
+   {
+   public:
+      explicit fire_journal(std::string const & path, journal_options const & options = {}) :
+         options(options)
+      {
+         fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+         if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "opening journal failed");
+
+         try
+         {
+            struct stat info{};
+            if (::fstat(fd, &info) < 0)
+               throw std::system_error(errno, std::generic_category(), "reading journal size failed");
+
+            // a crash while the header was first written leaves a shorter
+            // file, which holds no record yet: it is started over
+            if (info.st_size < static_cast<off_t>(CRON_JOURNAL_HEADER_SIZE))
+            {
+               if (info.st_size > 0 && ::ftruncate(fd, 0) < 0)
+                  throw std::system_error(errno, std::generic_category(), "truncating journal failed");
+
+               auto const header = detail::journal_header();
+               detail::write_all(fd, header.data(), header.size());
+               if (::fsync(fd) < 0)
+                  throw std::system_error(errno, std::generic_category(), "flushing journal failed");
+               end = header.size();
+            }
+            else
+            {
+               end = detail::scan_journal(fd, last);
+               if (end < static_cast<size_t>(info.st_size) && ::ftruncate(fd, static_cast<off_t>(end)) < 0)
+                  throw std::system_error(errno, std::generic_category(), "truncating journal failed");
+            }
+         }
+         catch (...)
+         {
+            ::close(fd);
+            throw;
+         }
+
+         last_commit = std::chrono::steady_clock::now();
+
+         if (options.sync_interval.count() > 0)
+            flusher = std::thread([this]() { flush(); });
+      }
+
+      // Commits the records still in memory.
+      ~fire_journal()
+      {
+         if (flusher.joinable())
+         {
+            {
+               std::lock_guard<std::mutex> lock(mutex);
+               stopping = true;
+            }
+            flush_wakeup.notify_one();
+            flusher.join();
+         }
+
+         try
+         {
+            sync();
+         }
+         catch (...)
+         {
+         }
+         ::close(fd);
+      }
+
+      fire_journal(fire_journal const &) = delete;
+      fire_journal& operator=(fire_journal const &) = delete;
+
+      // Records a fire. With a zero sync interval, returns once the record
+      // is on disk. Otherwise the record is committed at the latest once it
+      // has waited for the interval, earlier when max_batch records are
+      // waiting or by sync().
+      void record(std::uint64_t const id, std::time_t const time)
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+
+         if (pending.empty())
+         {
+            oldest_pending = std::chrono::steady_clock::now();
+            flush_wakeup.notify_one();
+         }
+
+         detail::append_journal_record(pending, id, time);
+         auto const sequence = ++appended;
+
+         auto [it, inserted] = last.emplace(id, time);
+         if (!inserted && time > it->second)
+            it->second = time;
+
+         if (options.sync_interval.count() > 0 &&
+             pending.size() < options.max_batch * CRON_JOURNAL_RECORD_SIZE &&
+             std::chrono::steady_clock::now() - last_commit < options.sync_interval)
+            return;
+
+         commit(lock, sequence);
+      }
+
+      // Writes and flushes every record appended so far.
+      void sync()
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         commit(lock, appended);
+      }
+
+      // Latest fire time of every job, from the journal and later records.
+      fire_times last_fires() const
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         return last;
+      }
+
+      // Number of records appended since the journal was opened and of
+      // those on disk.
+      std::pair<std::uint64_t, std::uint64_t> records() const
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         return { appended, committed };
+      }
+
+      // Number of write and fsync rounds, each covering one or more records.
+      std::uint64_t commits() const
+      {
+         std::lock_guard<std::mutex> lock(mutex);
+         return commit_count;
+      }
+
+   private:
+      // Body of the flusher thread: commits the waiting records once the
+      // oldest of them has waited for the sync interval. A failed commit is
+      // retried one interval later, or by the next record() or sync().
+      void flush()
+      {
+         std::unique_lock<std::mutex> lock(mutex);
+         while (!stopping)
+         {
+            if (pending.empty())
+            {
+               flush_wakeup.wait(lock);
+               continue;
+            }
+
+            auto const deadline = oldest_pending + options.sync_interval;
+            if (std::chrono::steady_clock::now() < deadline)
+            {
+               flush_wakeup.wait_until(lock, deadline);
+               continue;
+            }
+
+            try
+            {
+               commit(lock, appended);
+            }
+            catch (...)
+            {
+               oldest_pending = std::chrono::steady_clock::now();
+            }
+         }
+      }
+
+      // One thread at a time writes out the whole pending batch; the others
+      // wait for it and return if it covered their record.
+      void commit(std::unique_lock<std::mutex>& lock, std::uint64_t const sequence)
+      {
+         while (committed < sequence)
+         {
+            if (writing)
+            {
+               done.wait(lock);
+               continue;
+            }
+
+            writing = true;
+            std::vector<std::uint8_t> batch;
+            batch.swap(pending);
+            auto const upto = appended;
+            lock.unlock();
+
+            try
+            {
+               while (!batch.empty())
+               {
+                  auto const written = ::pwrite(fd, batch.data(), batch.size(), static_cast<off_t>(end));
+                  if (written < 0)
+                  {
+                     if (errno == EINTR) continue;
+                     throw std::system_error(errno, std::generic_category(), "writing journal failed");
+                  }
+                  end += static_cast<size_t>(written);
+                  batch.erase(batch.begin(), batch.begin() + written);
+               }
+
+               if (::fsync(fd) < 0)
+                  throw std::system_error(errno, std::generic_category(), "flushing journal failed");
+            }
+            catch (...)
+            {
+               lock.lock();
+               // the unwritten records go back in front of newer ones
+               pending.insert(pending.begin(), batch.begin(), batch.end());
+               writing = false;
+               done.notify_all();
+               throw;
+            }
+
+            lock.lock();
+            writing = false;
+            committed = upto;
+            ++commit_count;
+            last_commit = std::chrono::steady_clock::now();
+            done.notify_all();
+         }
+      }
+
+      journal_options                        options;
+      int                                    fd = -1;
+      size_t                                 end = 0;
+
+      mutable std::mutex                     mutex;
+      std::condition_variable                done;
+      std::condition_variable                flush_wakeup;
+      std::vector<std::uint8_t>              pending;
+      std::uint64_t                          appended = 0;
+      std::uint64_t                          committed = 0;
+      std::uint64_t                          commit_count = 0;
+      bool                                   writing = false;
+      std::chrono::steady_clock::time_point  last_commit;
+      std::chrono::steady_clock::time_point  oldest_pending;
+      bool                                   stopping = false;
+      fire_times                             last;
+      std::thread                            flusher;
+   };
+
+   // Wraps a scheduler callback so that every fire is journaled before the
+   // callback runs. With a zero sync interval no fire runs before it is on
+   // disk, so resuming each job after its last journaled fire runs every
+   // occurrence at most once across crashes.
+   template <typename Callback>
+   static auto journaled(fire_journal& journal, Callback fn)
+   {
+      return [&journal, fn = std::move(fn)](std::uint64_t const id, std::time_t const time) {
+         journal.record(id, time);
+         fn(id, time);
+      };
+   }
+}
+
+#endif
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "croncpp_crontab.h"
+#include "croncpp_scheduler.h"
+
+namespace cron
+{
+   struct reload_stats
+   {
+      size_t added = 0;
+      size_t updated = 0;
+      size_t removed = 0;
+      size_t unchanged = 0;
+      size_t errors = 0;
+   };
+
+   namespace detail
+   {
+      constexpr std::uint64_t combine_hash(std::uint64_t const a, std::uint64_t const b) noexcept
+      {
+         return a ^ (b + 0x9e3779b97f4a7c15ull + (a << 6) + (a >> 2));
+      }
+   }
+
+   // Keeps the jobs of a scheduler in step with a crontab. A reload hashes
+   // every line and parses only the lines that changed: a line identical to
+   // a loaded one keeps its job, a new schedule for a loaded command updates
+   // that job (adding it back if the scheduler no longer has it), other new
+   // lines add jobs and loaded lines that are gone cancel theirs. Changes go
+   // through the post_ functions of the scheduler, so reloads may run on
+   // another thread than the one advancing it, but not concurrently with
+   // each other.
+   template <typename Traits = cron_standard_traits, typename Clock = wall_clock>
+   class crontab_reloader
+   {
+   public:
+      using scheduler_type = scheduler<Traits, Clock>;
+      using callback = typename scheduler_type::callback;
+      using job_factory = std::function<callback(std::string_view command)>;
+      using error_function = std::function<void(crontab_error const &)>;
+
+      // factory makes the callback of a new or changed line from its command;
+      // an updated job keeps its callback unless it has to be added back.
+      // fields is the number of time fields of a line, as for read_crontab().
+      crontab_reloader(
+         scheduler_type& sched,
+         job_factory factory,
+         size_t const fields = 5,
+         job_options const & options = {}) :
+         sched(sched),
+         factory(std::move(factory)),
+         fields(fields),
+         options(options)
+      {
+      }
+
+      crontab_reloader(crontab_reloader const &) = delete;
+      crontab_reloader& operator=(crontab_reloader const &) = delete;
+
+      // Brings the jobs in line with text, reporting invalid lines to
+      // on_error. Invalid lines are left out as if they were absent.
+      reload_stats reload(std::string_view text, error_function const & on_error = nullptr)
+      {
+         reload_stats stats;
+         std::vector<loaded_job> loaded;
+         std::vector<changed_line> changed;
+         loaded.reserve(jobs.size());
+
+         std::unordered_multimap<std::uint64_t, size_t> by_line;
+         by_line.reserve(jobs.size());
+         for (size_t i = 0; i < jobs.size(); ++i)
+            by_line.emplace(jobs[i].line_hash, i);
+
+         auto const report = [&](crontab_error const & error) {
+            ++stats.errors;
+            if (on_error) on_error(error);
+         };
+
+         std::string buffer;
+         for (size_t number = 1; !text.empty(); ++number)
+         {
+            auto const end = text.find('\n');
+            auto line = text.substr(0, end);
+            text.remove_prefix(end == std::string_view::npos ? text.size() : end + 1);
+
+            auto const split = detail::split_crontab_line(line, fields, buffer);
+            if (split.kind == detail::crontab_line_kind::skip)
+               continue;
+
+            if (split.kind == detail::crontab_line_kind::error)
+            {
+               report(crontab_error{ number, line, std::string(split.message) });
+               continue;
+            }
+
+            auto const command_hash = utils::hash_key(split.command);
+            auto const line_hash = detail::combine_hash(utils::hash_key(buffer), command_hash);
+
+            auto const match = by_line.find(line_hash);
+            if (match != by_line.end())
+            {
+               loaded.push_back(jobs[match->second]);
+               by_line.erase(match);
+               ++stats.unchanged;
+            }
+            else
+            {
+               changed.push_back(changed_line{ buffer, split.command, line, number, line_hash, command_hash });
+            }
+         }
+
+         // jobs whose line is gone may still be updated by a changed line
+         // with the same command
+         std::unordered_multimap<std::uint64_t, job_id> by_command;
+         by_command.reserve(by_line.size());
+         for (auto const & entry : by_line)
+            by_command.emplace(jobs[entry.second].command_hash, jobs[entry.second].id);
+
+         for (auto const & line : changed)
+         {
+            cronexpr cex;
+            try
+            {
+               cex = cron::make_cron<Traits>(line.expression);
+            }
+            catch (bad_cronexpr const & ex)
+            {
+               report(crontab_error{ line.number, line.text, ex.what() });
+               continue;
+            }
+
+            job_id id = INVALID_JOB;
+            auto const match = by_command.find(line.command_hash);
+            if (match != by_command.end())
+            {
+               id = match->second;
+               by_command.erase(match);
+               // the job may be gone from the scheduler, e.g. after its last
+               // occurrence, so it is inserted again if needed
+               sched.post_upsert(id, cex, factory(line.command), options);
+               ++stats.updated;
+            }
+            else
+            {
+               id = sched.post_add(cex, factory(line.command), options);
+               ++stats.added;
+            }
+
+            loaded.push_back(loaded_job{ id, line.line_hash, line.command_hash });
+         }
+
+         for (auto const & entry : by_command)
+         {
+            sched.post_cancel(entry.second);
+            ++stats.removed;
+         }
+
+         jobs = std::move(loaded);
+         return stats;
+      }
+
+      // Number of jobs created from the crontab.
+      size_t size() const noexcept
+      {
+         return jobs.size();
+      }
+
+   private:
+      struct loaded_job
+      {
+         job_id        id;
+         std::uint64_t line_hash;
+         std::uint64_t command_hash;
+      };
+
+      struct changed_line
+      {
+         std::string      expression;
+         std::string_view command;
+         std::string_view text;
+         size_t           number;
+         std::uint64_t    line_hash;
+         std::uint64_t    command_hash;
+      };
+
+      scheduler_type&          sched;
+      job_factory              factory;
+      size_t                   fields;
+      job_options              options;
+      std::vector<loaded_job>  jobs;
+   };
+}
@@ -0,0 +1,1398 @@
+#pragma once
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+#include "croncpp.h"
+#include "croncpp_count.h"
+
+namespace cron
+{
+   using job_id = std::uint64_t;
+
+   constexpr job_id INVALID_JOB = 0;
+
+   // std::time() may read a coarse clock lagging behind timer expirations,
+   // so the precise system clock is used instead.
+   struct wall_clock
+   {
+      std::time_t operator()() const
+      {
+         return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+      }
+   };
+
+   // Virtual time source for tests and simulations. Copies share the same time.
+   class manual_clock
+   {
+   public:
+      explicit manual_clock(std::time_t const start = 0) :
+         now(std::make_shared<std::atomic<std::time_t>>(start))
+      {}
+
+      std::time_t operator()() const
+      {
+         return now->load();
+      }
+
+      void set(std::time_t const time)
+      {
+         now->store(time);
+      }
+
+      void advance(std::time_t const seconds)
+      {
+         now->fetch_add(seconds);
+      }
+
+   private:
+      std::shared_ptr<std::atomic<std::time_t>> now;
+   };
+
+   namespace detail
+   {
+      // Multiple-producer single-consumer queue after Dmitry Vyukov's
+      // intrusive node-based design. Producers never wait for each other or
+      // for the consumer: a push is one atomic exchange and one store.
+      template <typename T>
+      class mpsc_queue
+      {
+         struct node
+         {
+            std::atomic<node*> next{ nullptr };
+            T value{};
+         };
+
+      public:
+         mpsc_queue() :
+            head(new node()),
+            tail(head.load(std::memory_order_relaxed))
+         {}
+
+         ~mpsc_queue()
+         {
+            while (tail != nullptr)
+            {
+               node* next = tail->next.load(std::memory_order_relaxed);
+               delete tail;
+               tail = next;
+            }
+         }
+
+         mpsc_queue(mpsc_queue const &) = delete;
+         mpsc_queue& operator=(mpsc_queue const &) = delete;
+
+         void push(T value)
+         {
+            auto* item = new node();
+            item->value = std::move(value);
+
+            count.fetch_add(1, std::memory_order_relaxed);
+            node* prev = head.exchange(item, std::memory_order_acq_rel);
+            prev->next.store(item, std::memory_order_release);
+         }
+
+         // Consumer only. May miss an element whose push has not completed yet.
+         bool try_pop(T& value)
+         {
+            node* next = tail->next.load(std::memory_order_acquire);
+            if (next == nullptr) return false;
+
+            value = std::move(next->value);
+            delete tail;
+            tail = next;
+
+            count.fetch_sub(1, std::memory_order_relaxed);
+            return true;
+         }
+
+         // Consumer only.
+         bool empty() const noexcept
+         {
+            return tail->next.load(std::memory_order_acquire) == nullptr;
+         }
+
+         size_t size() const noexcept
+         {
+            return count.load(std::memory_order_relaxed);
+         }
+
+      private:
+         alignas(64) std::atomic<node*> head;
+         alignas(64) node* tail;
+         std::atomic<size_t> count{ 0 };
+      };
+
+      struct wheel_link
+      {
+         wheel_link* prev = this;
+         wheel_link* next = this;
+
+         wheel_link() = default;
+         wheel_link(wheel_link const &) = delete;
+         wheel_link& operator=(wheel_link const &) = delete;
+
+         bool empty() const noexcept
+         {
+            return next == this;
+         }
+
+         void push_back(wheel_link& node) noexcept
+         {
+            node.prev = prev;
+            node.next = this;
+            prev->next = &node;
+            prev = &node;
+         }
+
+         void unlink() noexcept
+         {
+            prev->next = next;
+            next->prev = prev;
+            prev = next = this;
+         }
+
+         void move_to(wheel_link& other) noexcept
+         {
+            if (empty()) return;
+
+            other.prev = prev;
+            other.next = next;
+            next->prev = &other;
+            prev->next = &other;
+            prev = next = this;
+         }
+      };
+
+      // Levels of the hierarchical wheel: seconds, minutes, hours and days.
+      // Deadlines further away than the last level wait in an overflow list.
+      constexpr size_t WHEEL_LEVELS = 4;
+      constexpr std::time_t WHEEL_GRANULARITY[WHEEL_LEVELS] = { 1, 60, 3600, 86400 };
+      constexpr size_t WHEEL_SLOTS[WHEEL_LEVELS] = { 60, 60, 24, 512 };
+
+      constexpr std::time_t wheel_span(size_t const level) noexcept
+      {
+         return WHEEL_GRANULARITY[level] * static_cast<std::time_t>(WHEEL_SLOTS[level]);
+      }
+
+      using dispatch_task = std::function<void()>;
+      using dispatch_function = std::function<void(dispatch_task)>;
+      using timed_dispatch_function = std::function<void(dispatch_task, std::time_t)>;
+
+      // Dispatchers take the task of a fired job, and optionally its fire
+      // time; those that take only the task are wrapped.
+      template <typename F>
+      timed_dispatch_function timed_dispatcher(F fn)
+      {
+         if constexpr (std::is_same_v<F, std::nullptr_t>)
+         {
+            return nullptr;
+         }
+         else if constexpr (std::is_invocable_v<F&, dispatch_task, std::time_t>)
+         {
+            return timed_dispatch_function(std::move(fn));
+         }
+         else
+         {
+            if constexpr (std::is_same_v<F, dispatch_function>)
+            {
+               if (!fn) return nullptr;
+            }
+
+            return [fn = std::move(fn)](dispatch_task task, std::time_t) mutable { fn(std::move(task)); };
+         }
+      }
+   }
+
+   // What to do with occurrences found more than misfire_threshold seconds
+   // past their tolerance window, because the scheduler was not advanced in
+   // time.
+   enum class misfire_policy
+   {
+      fire_all,       // fire every late occurrence
+      fire_now,       // fire the first late occurrence once and drop the others
+      skip_to_next,   // drop the late occurrences and wait for the next one
+      coalesce        // fire once, with the time of the latest late occurrence
+   };
+
+   // The jobs found due by one advance() are handed out by class first,
+   // then by earliest deadline (fire time plus tolerance).
+   enum class priority_class
+   {
+      critical,
+      normal,
+      batch
+   };
+
+   constexpr size_t PRIORITY_CLASSES = 3;
+
+   struct job_options
+   {
+      // How many seconds late the job may fire. Drivers that sleep until
+      // next_wakeup() use it to serve several deadlines with one wakeup.
+      std::time_t tolerance = 0;
+
+      misfire_policy misfire = misfire_policy::fire_all;
+      std::time_t misfire_threshold = 60;
+
+      // Maximum number of callbacks of the job running at once on the
+      // dispatcher; further fires are dropped. 0 means no limit.
+      size_t max_concurrent = 0;
+
+      priority_class priority = priority_class::normal;
+   };
+
+   struct misfire_stats
+   {
+      std::uint64_t misfired = 0;    // occurrences found late
+      std::uint64_t dropped = 0;     // late occurrences not fired
+      std::uint64_t coalesced = 0;   // late occurrences merged into another fire
+      std::uint64_t overruns = 0;    // fires dropped by max_concurrent
+   };
+
+   // Seconds between the fire time of a job and the moment its callback was
+   // run or handed to the dispatcher. buckets[0] counts fires on time and
+   // buckets[i] fires from 2^(i-1) to 2^i - 1 seconds late; the last bucket
+   // also counts anything later.
+   struct lateness_histogram
+   {
+      std::array<std::uint64_t, 16> buckets{};
+      std::uint64_t                 count = 0;
+      std::time_t                   max = 0;
+
+      void record(std::time_t const lateness) noexcept
+      {
+         size_t bucket = 0;
+         for (auto value = lateness; value > 0 && bucket + 1 < buckets.size(); value >>= 1)
+            ++bucket;
+
+         ++buckets[bucket];
+         ++count;
+         max = std::max(max, lateness);
+      }
+   };
+
+   // Dispatches callbacks for cron jobs. Jobs are kept in a hierarchical
+   // timing wheel, so adding and cancelling a job is O(1) regardless of how
+   // many jobs are registered. Time only moves when advance() or tick() is
+   // called; tick() reads the clock supplied as the Clock parameter.
+   // The scheduler is not thread-safe and callbacks run on the calling thread.
+   template <typename Traits = cron_standard_traits, typename Clock = wall_clock>
+   class scheduler
+   {
+   public:
+      using callback = std::function<void(job_id, std::time_t)>;
+      using task = detail::dispatch_task;
+      using dispatch_function = detail::dispatch_function;
+      using timed_dispatch_function = detail::timed_dispatch_function;
+
+   private:
+      struct job : detail::wheel_link
+      {
+         job_id      id = INVALID_JOB;
+         cronexpr    cex;
+         callback    fn;
+         std::time_t deadline = 0;
+         job_options options;
+         size_t      level = 0;
+
+         // callbacks still running on the dispatcher, when max_concurrent is set
+         std::shared_ptr<std::atomic<size_t>> running;
+      };
+
+      struct fired_job
+      {
+         job*           node;
+         job_id         id;
+         std::time_t    time;
+         std::time_t    due;
+         priority_class priority;
+         std::time_t    moment;   // the step of advance() that found it
+      };
+
+      enum class command_kind
+      {
+         add,
+         update,
+         upsert,
+         cancel,
+         move
+      };
+
+      struct command
+      {
+         command_kind kind = command_kind::cancel;
+         job_id       id = INVALID_JOB;
+         cronexpr     cex;
+         callback     fn;
+         job_options  options;
+         std::time_t  posted = 0;
+         std::time_t  next = INVALID_TIME;
+      };
+
+   public:
+      // A job taken out of a scheduler by detach(), with what is needed to
+      // schedule it in another one with post_move().
+      struct detached_job
+      {
+         job_id      id = INVALID_JOB;
+         cronexpr    cex;
+         callback    fn;
+         std::time_t next = INVALID_TIME;
+         job_options options;
+      };
+
+      explicit scheduler(Clock clock = Clock{}) :
+         time_source(std::move(clock)),
+         current(time_source())
+      {
+         for (size_t level = 0; level < detail::WHEEL_LEVELS; ++level)
+            wheels[level] = std::make_unique<detail::wheel_link[]>(detail::WHEEL_SLOTS[level]);
+      }
+
+      scheduler(scheduler const &) = delete;
+      scheduler& operator=(scheduler const &) = delete;
+
+      job_id add(cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         job_id id = INVALID_JOB;
+         do { id = next_id(); } while (contains(id));
+
+         return insert(id, cex, std::move(fn), options) ? id : INVALID_JOB;
+      }
+
+      // Adds a job under an identifier chosen by the caller. Fails if the
+      // identifier is in use or the expression has no future occurrence.
+      // The first fire follows the clock time, even when the scheduler was
+      // not advanced for a while, so no occurrence before the job existed
+      // fires.
+      bool insert(job_id const id, cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         return insert_at(id, cex, std::move(fn), INVALID_TIME, options);
+      }
+
+      // Like insert(), with the next fire time already known, e.g. when
+      // restoring a snapshot. If that time is not after the current time,
+      // the next occurrence is computed instead.
+      bool insert_at(job_id const id, cronexpr const & cex, callback fn, std::time_t next, job_options const & options = {})
+      {
+         return insert_from(id, cex, std::move(fn), next, options, origin());
+      }
+
+      // Replaces the expression of a job; the next fire is computed from the
+      // clock time, or the time reached by advance() if that is later. A job
+      // whose new expression never fires is removed.
+      bool update(job_id const id, cronexpr const & cex)
+      {
+         return update_from(id, cex, origin());
+      }
+
+      // Updates a job, or inserts it with fn and options when the scheduler
+      // does not have it, e.g. because it ran its last occurrence or its
+      // expression never fired.
+      bool upsert(job_id const id, cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         return upsert_from(id, cex, std::move(fn), options, origin());
+      }
+
+      bool cancel(job_id const id)
+      {
+         auto it = jobs.find(id);
+         if (it == jobs.end()) return false;
+
+         job* node = it->second;
+         jobs.erase(it);
+
+         remove(*node);
+         node->id = INVALID_JOB;
+         retire(node);
+
+         return true;
+      }
+
+      // The post_ functions may be called from any thread, concurrently with
+      // the thread advancing the scheduler. They never block: commands go to
+      // a lock-free queue that is drained at the start of every advance().
+      // Each command records the clock time it was posted at, and new and
+      // updated jobs first fire after it, however long the scheduler waits
+      // before applying the command.
+      job_id post_add(cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         auto const id = next_id();
+         post_insert(id, cex, std::move(fn), options);
+         return id;
+      }
+
+      void post_insert(job_id const id, cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         commands.push(command{ command_kind::add, id, cex, std::move(fn), options, time_source() });
+      }
+
+      void post_update(job_id const id, cronexpr const & cex)
+      {
+         commands.push(command{ command_kind::update, id, cex, nullptr, {}, time_source() });
+      }
+
+      void post_upsert(job_id const id, cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         commands.push(command{ command_kind::upsert, id, cex, std::move(fn), options, time_source() });
+      }
+
+      void post_cancel(job_id const id)
+      {
+         commands.push(command{ command_kind::cancel, id, cronexpr{}, nullptr, {} });
+      }
+
+      // Queues a job detached from another scheduler. It keeps its next fire
+      // time and fires late if that time has passed when the command is
+      // applied.
+      void post_move(detached_job job)
+      {
+         commands.push(command{
+            command_kind::move, job.id, job.cex, std::move(job.fn), job.options, time_source(), job.next });
+      }
+
+      // Removes a job, keeping its expression, callback, options and next
+      // fire time. Must not be called from a callback.
+      bool detach(job_id const id, detached_job& out)
+      {
+         auto it = jobs.find(id);
+         if (it == jobs.end()) return false;
+
+         job* node = it->second;
+         out.id = id;
+         out.cex = node->cex;
+         out.fn = node->fn;
+         out.next = node->deadline;
+         out.options = node->options;
+
+         return cancel(id);
+      }
+
+      // Identifiers of up to limit jobs, in no particular order.
+      std::vector<job_id> job_ids(size_t const limit) const
+      {
+         std::vector<job_id> ids;
+         ids.reserve(std::min(limit, jobs.size()));
+         for (auto it = jobs.begin(); it != jobs.end() && ids.size() < limit; ++it)
+            ids.push_back(it->first);
+         return ids;
+      }
+
+      size_t pending_commands() const noexcept
+      {
+         return commands.size();
+      }
+
+      // Applies the posted commands. Must be called from the thread that
+      // advances the scheduler; advance() does it automatically.
+      size_t apply_commands()
+      {
+         size_t applied = 0;
+
+         command cmd;
+         while (commands.try_pop(cmd))
+         {
+            auto const from = std::max(current, cmd.posted);
+
+            switch (cmd.kind)
+            {
+            case command_kind::add:
+               insert_from(cmd.id, cmd.cex, std::move(cmd.fn), INVALID_TIME, cmd.options, from);
+               break;
+            case command_kind::update:
+               update_from(cmd.id, cmd.cex, from);
+               break;
+            case command_kind::upsert:
+               upsert_from(cmd.id, cmd.cex, std::move(cmd.fn), cmd.options, from);
+               break;
+            case command_kind::cancel:
+               cancel(cmd.id);
+               break;
+            case command_kind::move:
+               insert_from(cmd.id, cmd.cex, std::move(cmd.fn), cmd.next, cmd.options, from, true);
+               break;
+            }
+            ++applied;
+         }
+
+         return applied;
+      }
+
+      bool contains(job_id const id) const
+      {
+         return jobs.find(id) != jobs.end();
+      }
+
+      size_t size() const noexcept
+      {
+         return jobs.size();
+      }
+
+      std::time_t now() const noexcept
+      {
+         return current;
+      }
+
+      Clock& clock() noexcept
+      {
+         return time_source;
+      }
+
+      // Earliest pending deadline, or INVALID_TIME when there are no jobs.
+      std::time_t next_deadline() const
+      {
+         std::time_t best = INVALID_TIME;
+
+         for (size_t level = 0; level < detail::WHEEL_LEVELS; ++level)
+         {
+            if (level_size[level] == 0) continue;
+
+            auto const slots = detail::WHEEL_SLOTS[level];
+            auto const slot = slot_of(current, level);
+            for (size_t i = 1; i <= slots; ++i)
+            {
+               auto const & head = wheels[level][(slot + i) % slots];
+               if (!head.empty())
+               {
+                  best = earliest(head, best);
+                  break;
+               }
+            }
+         }
+
+         if (level_size[detail::WHEEL_LEVELS] > 0)
+            best = earliest(overflow, best);
+
+         return best;
+      }
+
+      // The latest moment at which every due job is still within its
+      // tolerance: the minimum of deadline + tolerance over all jobs. Sleeping
+      // until then and calling tick() fires every job whose deadline falls in
+      // that window with a single wakeup. Equals next_deadline() when no job
+      // has a tolerance.
+      std::time_t next_wakeup() const
+      {
+         if (max_tolerance == 0) return next_deadline();
+
+         std::time_t best = INVALID_TIME;
+
+         for (size_t level = 0; level < detail::WHEEL_LEVELS; ++level)
+         {
+            if (level_size[level] == 0) continue;
+
+            auto const step = detail::WHEEL_GRANULARITY[level];
+            auto const slots = detail::WHEEL_SLOTS[level];
+            auto const slot = slot_of(current, level);
+            for (size_t i = 1; i <= slots; ++i)
+            {
+               // no deadline in this slot or the following ones can lower the bound
+               auto const lower = (current / step + static_cast<std::time_t>(i) - 1) * step;
+               if (INVALID_TIME != best && lower > best) break;
+
+               best = earliest_wakeup(wheels[level][(slot + i) % slots], best);
+            }
+         }
+
+         if (level_size[detail::WHEEL_LEVELS] > 0)
+            best = earliest_wakeup(overflow, best);
+
+         return best;
+      }
+
+      misfire_stats misfires() const noexcept
+      {
+         return misfire_counters;
+      }
+
+      lateness_histogram const & lateness(priority_class const priority) const noexcept
+      {
+         return lateness_histograms[static_cast<size_t>(priority)];
+      }
+
+      // Number of wakeups avoided because one advance() fired jobs due at
+      // different moments.
+      size_t wakeups_saved() const noexcept
+      {
+         return saved_wakeups;
+      }
+
+      // Hands the callbacks of fired jobs to an executor instead of running
+      // them on the thread that advances the scheduler. The dispatcher is
+      // called with the task, or with the task and the fire time of the job
+      // if it accepts both, e.g. to measure latency from the fire time.
+      template <typename F>
+      void set_dispatcher(F fn)
+      {
+         dispatcher = detail::timed_dispatcher(std::move(fn));
+      }
+
+      size_t tick()
+      {
+         return advance(time_source());
+      }
+
+      // Moves time forward to the given moment, invoking the callback of every
+      // job whose deadline is not later than it. Returns the number of fires.
+      // The jobs due anywhere in the interval are collected first and run
+      // together, so a critical job due a second after a batch job still
+      // runs first.
+      size_t advance(std::time_t const target)
+      {
+         apply_commands();
+
+         while (current < target)
+         {
+            current = next_step(target);
+
+            cascade(current);
+            collect(current, target);
+         }
+
+         auto const fired = dispatch(target);
+
+         release_retired();
+
+         return fired;
+      }
+
+   private:
+      job_id next_id() noexcept
+      {
+         return last_id.fetch_add(1, std::memory_order_relaxed) + 1;
+      }
+
+      // The time new and updated jobs start from: the clock may be ahead of
+      // the last advance() when the scheduler was idle, and occurrences
+      // before a job existed must not fire.
+      std::time_t origin() const
+      {
+         return std::max(current, time_source());
+      }
+
+      // With keep_next, a next fire time already passed is kept and the job
+      // fires late at the next step.
+      bool insert_from(
+         job_id const id,
+         cronexpr const & cex,
+         callback fn,
+         std::time_t next,
+         job_options const & options,
+         std::time_t const from,
+         bool const keep_next = false)
+      {
+         if (INVALID_JOB == id || contains(id)) return false;
+
+         if (INVALID_TIME == next || (next <= current && !keep_next))
+            next = cron_next<Traits>(cex, from);
+         if (INVALID_TIME == next) return false;
+
+         job& node = allocate();
+         node.id = id;
+         node.cex = cex;
+         node.fn = std::move(fn);
+         node.deadline = next;
+         node.options = options;
+         node.options.tolerance = std::max<std::time_t>(0, options.tolerance);
+         node.running = options.max_concurrent > 0 ? std::make_shared<std::atomic<size_t>>(0) : nullptr;
+         max_tolerance = std::max(max_tolerance, node.options.tolerance);
+
+         jobs.emplace(node.id, &node);
+         if (next > current)
+         {
+            schedule(node, current);
+         }
+         else
+         {
+            node.level = 0;
+            ++level_size[0];
+            wheels[0][slot_of(current + 1, 0)].push_back(node);
+         }
+
+         return true;
+      }
+
+      bool update_from(job_id const id, cronexpr const & cex, std::time_t const from)
+      {
+         auto it = jobs.find(id);
+         if (it == jobs.end()) return false;
+
+         auto const next = cron_next<Traits>(cex, from);
+         if (INVALID_TIME == next) return cancel(id);
+
+         job& node = *it->second;
+         remove(node);
+         node.cex = cex;
+         node.deadline = next;
+         schedule(node, current);
+
+         return true;
+      }
+
+      bool upsert_from(job_id const id, cronexpr const & cex, callback fn, job_options const & options, std::time_t const from)
+      {
+         if (contains(id)) return update_from(id, cex, from);
+         return insert_from(id, cex, std::move(fn), INVALID_TIME, options, from);
+      }
+
+      job& allocate()
+      {
+         if (!free_nodes.empty())
+         {
+            job* node = free_nodes.back();
+            free_nodes.pop_back();
+            return *node;
+         }
+
+         return pool.emplace_back();
+      }
+
+      void retire(job* node)
+      {
+         retired.push_back(node);
+         if (!dispatching) release_retired();
+      }
+
+      void release_retired()
+      {
+         for (job* node : retired)
+         {
+            node->id = INVALID_JOB;
+            node->fn = nullptr;
+            free_nodes.push_back(node);
+         }
+         retired.clear();
+      }
+
+      static size_t slot_of(std::time_t const time, size_t const level) noexcept
+      {
+         return static_cast<size_t>(time / detail::WHEEL_GRANULARITY[level]) % detail::WHEEL_SLOTS[level];
+      }
+
+      static bool aligned(std::time_t const time, size_t const level) noexcept
+      {
+         return time % detail::WHEEL_GRANULARITY[level] == 0;
+      }
+
+      static std::time_t earliest(detail::wheel_link const & head, std::time_t best) noexcept
+      {
+         for (auto const * link = head.next; link != &head; link = link->next)
+         {
+            auto const deadline = static_cast<job const *>(link)->deadline;
+            if (INVALID_TIME == best || deadline < best)
+               best = deadline;
+         }
+         return best;
+      }
+
+      static std::time_t earliest_wakeup(detail::wheel_link const & head, std::time_t best) noexcept
+      {
+         for (auto const * link = head.next; link != &head; link = link->next)
+         {
+            auto const & node = *static_cast<job const *>(link);
+            auto const wakeup = node.deadline + node.options.tolerance;
+            if (INVALID_TIME == best || wakeup < best)
+               best = wakeup;
+         }
+         return best;
+      }
+
+      void schedule(job& node, std::time_t const reference)
+      {
+         auto const delta = node.deadline - reference;
+
+         size_t level = 0;
+         while (level < detail::WHEEL_LEVELS && delta >= detail::wheel_span(level))
+            ++level;
+
+         node.level = level;
+         ++level_size[level];
+
+         if (level == detail::WHEEL_LEVELS)
+            overflow.push_back(node);
+         else
+            wheels[level][slot_of(node.deadline, level)].push_back(node);
+      }
+
+      void remove(job& node)
+      {
+         if (node.empty()) return;
+
+         node.unlink();
+         --level_size[node.level];
+      }
+
+      // The next moment at which something can happen: the next second while
+      // the seconds wheel holds jobs, otherwise the next boundary of the
+      // finest level that is not empty.
+      std::time_t next_step(std::time_t const target) const noexcept
+      {
+         for (size_t level = 0; level < detail::WHEEL_LEVELS; ++level)
+         {
+            if (level_size[level] > 0)
+            {
+               auto const step = detail::WHEEL_GRANULARITY[level];
+               return std::min(target, (current / step + 1) * step);
+            }
+         }
+
+         if (level_size[detail::WHEEL_LEVELS] > 0)
+         {
+            auto const step = detail::wheel_span(detail::WHEEL_LEVELS - 1);
+            return std::min(target, (current / step + 1) * step);
+         }
+
+         return target;
+      }
+
+      void redistribute(detail::wheel_link& head, std::time_t const time)
+      {
+         detail::wheel_link pending;
+         head.move_to(pending);
+
+         while (!pending.empty())
+         {
+            auto& node = static_cast<job&>(*pending.next);
+            node.unlink();
+            --level_size[node.level];
+            schedule(node, time);
+         }
+      }
+
+      void cascade(std::time_t const time)
+      {
+         constexpr auto top = detail::WHEEL_LEVELS - 1;
+
+         if (time % detail::wheel_span(top) == 0)
+            redistribute(overflow, time);
+
+         for (size_t level = top; level > 0; --level)
+         {
+            if (aligned(time, level) && level_size[level] > 0)
+               redistribute(wheels[level][slot_of(time, level)], time);
+         }
+      }
+
+      // Collects the jobs due at the given time. The time actually reached,
+      // now, tells how late they are.
+      void collect(std::time_t const time, std::time_t const now)
+      {
+         auto& head = wheels[0][slot_of(time, 0)];
+
+         while (!head.empty())
+         {
+            auto& node = static_cast<job&>(*head.next);
+            remove(node);
+
+            auto fire_time = node.deadline;
+            auto resume_from = node.deadline;
+            bool fire = true;
+
+            // occurrences up to this moment are more than the threshold late
+            auto const late_until = now - node.options.tolerance - node.options.misfire_threshold - 1;
+
+            if (node.deadline <= late_until)
+            {
+               ++misfire_counters.misfired;
+
+               if (node.options.misfire != misfire_policy::fire_all)
+               {
+                  // the later occurrences that are late as well are handled
+                  // at once; those still within the threshold fire normally
+                  auto const later = cron_count<Traits>(node.cex, node.deadline, late_until);
+                  misfire_counters.misfired += later;
+                  resume_from = late_until;
+
+                  switch (node.options.misfire)
+                  {
+                  case misfire_policy::fire_now:
+                     misfire_counters.dropped += later;
+                     break;
+                  case misfire_policy::skip_to_next:
+                     misfire_counters.dropped += later + 1;
+                     fire = false;
+                     break;
+                  case misfire_policy::coalesce:
+                     if (later > 0)
+                     {
+                        auto const latest = cron_nth<Traits>(node.cex, node.deadline, later);
+                        if (INVALID_TIME != latest) fire_time = latest;
+                     }
+                     misfire_counters.coalesced += later;
+                     break;
+                  default:
+                     break;
+                  }
+               }
+            }
+
+            if (fire)
+            {
+               batch.push_back(fired_job{
+                  &node, node.id, fire_time, fire_time + node.options.tolerance, node.options.priority, time });
+            }
+
+            auto const next = cron_next<Traits>(node.cex, resume_from);
+            if (INVALID_TIME == next)
+            {
+               jobs.erase(node.id);
+               retired.push_back(&node);
+            }
+            else
+            {
+               node.deadline = next;
+               schedule(node, time);
+            }
+         }
+      }
+
+      // Runs or hands out the jobs collected by one advance(), ordered by
+      // priority class and then by deadline. now is used to measure
+      // lateness.
+      size_t dispatch(std::time_t const now)
+      {
+         struct guard
+         {
+            scheduler& owner;
+            explicit guard(scheduler& s) : owner(s) { owner.dispatching = true; }
+            ~guard() { owner.dispatching = false; owner.batch.clear(); owner.moments.clear(); }
+         } const dispatch_guard(*this);
+
+         if (batch.size() > 1)
+         {
+            std::stable_sort(batch.begin(), batch.end(), [](fired_job const & a, fired_job const & b) {
+               return a.priority != b.priority ? a.priority < b.priority : a.due < b.due;
+            });
+         }
+
+         size_t fired = 0;
+         for (auto const & item : batch)
+         {
+            // skip jobs cancelled by an earlier callback of the same batch
+            if (item.node->id != item.id) continue;
+
+            auto const & node = *item.node;
+            if (dispatcher && node.running &&
+                node.running->load(std::memory_order_acquire) >= node.options.max_concurrent)
+            {
+               ++misfire_counters.overruns;
+               continue;
+            }
+
+            lateness_histograms[static_cast<size_t>(item.priority)].record(now - item.time);
+
+            if (!dispatcher)
+            {
+               node.fn(item.id, item.time);
+            }
+            else if (!node.running)
+            {
+               dispatcher([fn = node.fn, id = item.id, time = item.time]() { fn(id, time); }, item.time);
+            }
+            else
+            {
+               node.running->fetch_add(1, std::memory_order_acq_rel);
+               dispatcher([fn = node.fn, id = item.id, time = item.time, running = node.running]() {
+                  struct release
+                  {
+                     std::atomic<size_t>& count;
+                     ~release() { count.fetch_sub(1, std::memory_order_release); }
+                  } const done{ *running };
+
+                  fn(id, time);
+               }, item.time);
+            }
+            ++fired;
+            moments.push_back(item.moment);
+         }
+
+         // fires found at different steps share this wakeup
+         std::sort(moments.begin(), moments.end());
+         auto const distinct = static_cast<size_t>(std::unique(moments.begin(), moments.end()) - moments.begin());
+         if (distinct > 1) saved_wakeups += distinct - 1;
+
+         return fired;
+      }
+
+      Clock time_source;
+      std::time_t current;
+      std::atomic<job_id> last_id{ INVALID_JOB };
+      detail::mpsc_queue<command> commands;
+
+      std::unique_ptr<detail::wheel_link[]> wheels[detail::WHEEL_LEVELS];
+      detail::wheel_link overflow;
+      size_t level_size[detail::WHEEL_LEVELS + 1] = {};
+      std::time_t max_tolerance = 0;
+      size_t saved_wakeups = 0;
+      misfire_stats misfire_counters;
+      lateness_histogram lateness_histograms[PRIORITY_CLASSES];
+
+      std::unordered_map<job_id, job*> jobs;
+      std::deque<job> pool;
+      std::vector<job*> free_nodes;
+      std::vector<job*> retired;
+
+      std::vector<fired_job> batch;
+      std::vector<std::time_t> moments;
+      bool dispatching = false;
+      timed_dispatch_function dispatcher;
+   };
+
+   // Spreads jobs over several shards, each with its own timing wheel and
+   // worker thread. A new job goes to the less loaded of two shards picked by
+   // hashing its identifier, without ever pausing the others. Between ticks,
+   // a shard holding clearly more jobs than the lightest one moves the
+   // difference over; moved jobs keep their next fire time. A map from
+   // identifier to shard, split over mutex stripes, routes updates and
+   // cancellations to the current owner. These operations are thread-safe:
+   // they hold one stripe briefly and post to the command queue of the shard,
+   // which applies it between ticks. Firing takes no shared lock. Callbacks
+   // run on the thread of the shard that owns the job unless a dispatcher is
+   // set.
+   template <typename Traits = cron_standard_traits, typename Clock = wall_clock>
+   class sharded_scheduler
+   {
+   public:
+      using callback = typename scheduler<Traits, Clock>::callback;
+      using dispatch_function = typename scheduler<Traits, Clock>::dispatch_function;
+      using timed_dispatch_function = typename scheduler<Traits, Clock>::timed_dispatch_function;
+
+   private:
+      struct alignas(64) shard
+      {
+         explicit shard(Clock const & clock) : sched(clock) {}
+
+         scheduler<Traits, Clock> sched;
+
+         // only used to park the shard thread while it has nothing to do
+         std::mutex              mutex;
+         std::condition_variable wakeup;
+         std::atomic<bool>       sleeping{ false };
+         bool                    stopping = false;
+         timed_dispatch_function dispatcher;
+         bool                    dispatcher_changed = false;
+
+         std::atomic<size_t>     size{ 0 };
+         std::atomic<size_t>     fired{ 0 };
+         std::atomic<size_t>     saved{ 0 };
+
+         std::thread             worker;
+      };
+
+      static constexpr size_t OWNER_STRIPES = 64;
+
+      struct alignas(64) owner_stripe
+      {
+         std::mutex                         mutex;
+         std::unordered_map<job_id, size_t> shards;
+      };
+
+   public:
+      explicit sharded_scheduler(
+         size_t const shards = std::max(1u, std::thread::hardware_concurrency()),
+         Clock clock = Clock{},
+         std::chrono::milliseconds const poll_interval = std::chrono::milliseconds(1000)) :
+         time_source(std::move(clock)),
+         poll(poll_interval),
+         shard_count(std::max<size_t>(1, shards))
+      {
+         for (size_t i = 0; i < shard_count; ++i)
+            all_shards.push_back(std::make_unique<shard>(time_source));
+
+         for (size_t i = 0; i < shard_count; ++i)
+            all_shards[i]->worker = std::thread([this, i]() { run(i); });
+      }
+
+      ~sharded_scheduler()
+      {
+         for (auto & s : all_shards)
+         {
+            {
+               std::lock_guard<std::mutex> lock(s->mutex);
+               s->stopping = true;
+            }
+            s->wakeup.notify_one();
+         }
+
+         for (auto & s : all_shards)
+            s->worker.join();
+      }
+
+      sharded_scheduler(sharded_scheduler const &) = delete;
+      sharded_scheduler& operator=(sharded_scheduler const &) = delete;
+
+      job_id add(cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         if (INVALID_TIME == cron_next<Traits>(cex, time_source()))
+            return INVALID_JOB;
+
+         auto const sequence = last_sequence.fetch_add(1, std::memory_order_relaxed) + 1;
+
+         auto const first = mix(sequence) % shard_count;
+         auto const second = mix(sequence ^ 0x9e3779b97f4a7c15ull) % shard_count;
+         auto const index = load(first) <= load(second) ? first : second;
+
+         auto const id = static_cast<job_id>(sequence);
+         auto & s = *all_shards[index];
+
+         {
+            auto & stripe = stripe_of(id);
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            stripe.shards.emplace(id, index);
+            s.sched.post_insert(id, cex, std::move(fn), options);
+         }
+         notify(s);
+
+         return id;
+      }
+
+      // Queues a change of expression. Returns false for unknown or
+      // cancelled jobs.
+      bool update(job_id const id, cronexpr const & cex)
+      {
+         shard* owner = nullptr;
+         {
+            auto & stripe = stripe_of(id);
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            auto it = stripe.shards.find(id);
+            if (it == stripe.shards.end()) return false;
+
+            owner = all_shards[it->second].get();
+            owner->sched.post_update(id, cex);
+         }
+         notify(*owner);
+
+         return true;
+      }
+
+      // Queues the cancellation of a job. Returns false for unknown or
+      // already cancelled jobs.
+      bool cancel(job_id const id)
+      {
+         shard* owner = nullptr;
+         {
+            auto & stripe = stripe_of(id);
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+            auto it = stripe.shards.find(id);
+            if (it == stripe.shards.end()) return false;
+
+            owner = all_shards[it->second].get();
+            owner->sched.post_cancel(id);
+            stripe.shards.erase(it);
+         }
+         notify(*owner);
+
+         return true;
+      }
+
+      // Index of the shard that currently owns a job, or shards() for
+      // unknown jobs.
+      size_t shard_of(job_id const id) const
+      {
+         auto & stripe = stripe_of(id);
+         std::lock_guard<std::mutex> lock(stripe.mutex);
+         auto it = stripe.shards.find(id);
+         return it == stripe.shards.end() ? shard_count : it->second;
+      }
+
+      // Hands fired callbacks of every shard to an executor; see
+      // scheduler::set_dispatcher().
+      template <typename F>
+      void set_dispatcher(F fn)
+      {
+         auto const timed = detail::timed_dispatcher(std::move(fn));
+         for (auto & s : all_shards)
+         {
+            {
+               std::lock_guard<std::mutex> lock(s->mutex);
+               s->dispatcher = timed;
+               s->dispatcher_changed = true;
+            }
+            s->wakeup.notify_one();
+         }
+      }
+
+      size_t shards() const noexcept
+      {
+         return shard_count;
+      }
+
+      // Approximate number of jobs owned by a shard, counting queued commands.
+      size_t load(size_t const index) const noexcept
+      {
+         auto const & s = *all_shards[index];
+         return s.size.load(std::memory_order_relaxed) + s.sched.pending_commands();
+      }
+
+      size_t size() const noexcept
+      {
+         size_t total = 0;
+         for (size_t i = 0; i < shard_count; ++i)
+            total += load(i);
+         return total;
+      }
+
+      size_t fired() const noexcept
+      {
+         size_t total = 0;
+         for (auto const & s : all_shards)
+            total += s->fired.load(std::memory_order_relaxed);
+         return total;
+      }
+
+      size_t wakeups_saved() const noexcept
+      {
+         size_t total = 0;
+         for (auto const & s : all_shards)
+            total += s->saved.load(std::memory_order_relaxed);
+         return total;
+      }
+
+      // Number of jobs moved between shards so far.
+      size_t migrated() const noexcept
+      {
+         return moved.load(std::memory_order_relaxed);
+      }
+
+   private:
+      static std::uint64_t mix(std::uint64_t value) noexcept
+      {
+         value ^= value >> 33;
+         value *= 0xff51afd7ed558ccdull;
+         value ^= value >> 33;
+         value *= 0xc4ceb9fe1a85ec53ull;
+         value ^= value >> 33;
+         return value;
+      }
+
+      owner_stripe& stripe_of(job_id const id) const noexcept
+      {
+         return owners[id % OWNER_STRIPES];
+      }
+
+      // Wakes the shard thread if it is parked. The fences pair with the ones
+      // in run(): either the producer sees the shard asleep or the shard sees
+      // the new command before it parks.
+      void notify(shard& s)
+      {
+         std::atomic_thread_fence(std::memory_order_seq_cst);
+         if (s.sleeping.load(std::memory_order_relaxed))
+         {
+            { std::lock_guard<std::mutex> lock(s.mutex); }
+            s.wakeup.notify_one();
+         }
+      }
+
+      std::chrono::milliseconds wait_time(shard const & s) const
+      {
+         if constexpr (std::is_same_v<Clock, wall_clock>)
+         {
+            auto const next = s.sched.next_wakeup();
+            if (INVALID_TIME != next)
+            {
+               auto const remaining = std::chrono::duration_cast<std::chrono::milliseconds>(
+                  std::chrono::system_clock::from_time_t(next) - std::chrono::system_clock::now());
+               return std::max(std::chrono::milliseconds(0), std::min(poll, remaining));
+            }
+         }
+
+         return poll;
+      }
+
+      // Moves jobs to the lightest shard when this one holds more than an
+      // eighth, and at least eight jobs, above it. Each job moves with its
+      // stripe locked, after the commands already posted to it are applied,
+      // so an update or cancellation reaches either the old owner before the
+      // move or the new one after it.
+      void rebalance(size_t const index)
+      {
+         auto & s = *all_shards[index];
+
+         size_t lightest = index;
+         for (size_t i = 0; i < shard_count; ++i)
+            if (load(i) < load(lightest)) lightest = i;
+
+         auto const own = s.sched.size() + s.sched.pending_commands();
+         auto const other = load(lightest);
+         if (lightest == index || own <= other || own - other <= std::max<size_t>(8, own / 8))
+            return;
+
+         auto & target = *all_shards[lightest];
+         size_t count = 0;
+         for (auto const id : s.sched.job_ids((own - other) / 2))
+         {
+            auto & stripe = stripe_of(id);
+            std::lock_guard<std::mutex> lock(stripe.mutex);
+
+            s.sched.apply_commands();
+            typename scheduler<Traits, Clock>::detached_job job;
+            if (!s.sched.detach(id, job)) continue;
+
+            auto it = stripe.shards.find(id);
+            if (it != stripe.shards.end()) it->second = lightest;
+            target.sched.post_move(std::move(job));
+            ++count;
+         }
+
+         if (count > 0)
+         {
+            notify(target);
+            moved.fetch_add(count, std::memory_order_relaxed);
+            s.size.store(s.sched.size(), std::memory_order_relaxed);
+         }
+      }
+
+      void run(size_t const index)
+      {
+         auto & s = *all_shards[index];
+         for (;;)
+         {
+            {
+               std::unique_lock<std::mutex> lock(s.mutex);
+               s.sleeping.store(true, std::memory_order_relaxed);
+               std::atomic_thread_fence(std::memory_order_seq_cst);
+               s.wakeup.wait_for(lock, wait_time(s), [&s]() {
+                  return s.stopping || s.dispatcher_changed || s.sched.pending_commands() > 0;
+               });
+               s.sleeping.store(false, std::memory_order_relaxed);
+
+               if (s.stopping) return;
+
+               if (s.dispatcher_changed)
+               {
+                  s.sched.set_dispatcher(std::move(s.dispatcher));
+                  s.dispatcher_changed = false;
+               }
+            }
+
+            s.fired.fetch_add(s.sched.tick(), std::memory_order_relaxed);
+            s.size.store(s.sched.size(), std::memory_order_relaxed);
+            s.saved.store(s.sched.wakeups_saved(), std::memory_order_relaxed);
+
+            rebalance(index);
+         }
+      }
+
+      Clock time_source;
+      std::chrono::milliseconds const poll;
+      size_t const shard_count;
+      std::vector<std::unique_ptr<shard>> all_shards;
+      std::atomic<std::uint64_t> last_sequence{ 0 };
+      std::atomic<size_t> moved{ 0 };
+      mutable owner_stripe owners[OWNER_STRIPES];
+   };
+}
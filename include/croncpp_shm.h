@@ -0,0 +1,327 @@
+#pragma once
+
+// POSIX only: the table lives in a shm_open() segment mapped with mmap().
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "croncpp_snapshot.h"
+
+namespace cron
+{
+   // Segment layout. A 64-byte header:
+   //
+   //    offset  size  content
+   //         0     8  magic "CRONSHMT"
+   //         8     4  format version
+   //        12     4  record size (64)
+   //        16     8  number of records
+   //        24     1  dialect tag of the traits
+   //        28     4  ready flag, set once the records are written
+   //
+   // followed by one 64-byte record per job, sorted by identifier:
+   //
+   //         0     8  job identifier
+   //         8     8  next fire time, updated atomically
+   //        16    45  expression, as written by cron_serialize()
+   //
+   // Everything is addressed by offset, so the segment may be mapped at any
+   // address in every process.
+   constexpr std::uint32_t CRON_SHM_VERSION = 1;
+   constexpr size_t CRON_SHM_RECORD_SIZE = 64;
+
+   namespace detail
+   {
+      constexpr char SHM_MAGIC[8] = { 'C', 'R', 'O', 'N', 'S', 'H', 'M', 'T' };
+
+      using shm_time = std::atomic<std::int64_t>;
+      using shm_flag = std::atomic<std::uint32_t>;
+
+      // Atomics shared between processes must not rely on a lock local to
+      // one process.
+      static_assert(shm_time::is_always_lock_free && shm_flag::is_always_lock_free,
+         "shared schedule tables need lock-free 64-bit atomics");
+      static_assert(sizeof(shm_time) == 8 && sizeof(shm_flag) == 4,
+         "unexpected size of atomic types");
+   }
+
+   // Schedule table in a named shared-memory segment. One process creates
+   // it; any number of processes open it and share one copy of the
+   // expressions. Each job has a next fire time slot that workers advance
+   // with compare-and-swap, so every occurrence is claimed by exactly one
+   // worker.
+   template <typename Traits = cron_standard_traits>
+   class shared_schedule
+   {
+   public:
+      // Creates the segment, which must not exist yet, holding the given
+      // jobs. The next time of an entry is its first occurrence to claim.
+      // Throws std::system_error if the segment cannot be created and
+      // std::invalid_argument if an identifier appears twice.
+      static shared_schedule create(std::string const & name, std::vector<snapshot_entry> entries)
+      {
+         std::sort(entries.begin(), entries.end(),
+            [](snapshot_entry const & a, snapshot_entry const & b) { return a.id < b.id; });
+         auto const duplicate = std::adjacent_find(entries.begin(), entries.end(),
+            [](snapshot_entry const & a, snapshot_entry const & b) { return a.id == b.id; });
+         if (duplicate != entries.end())
+            throw std::invalid_argument("Duplicate job identifier in shared schedule");
+
+         int const fd = ::shm_open(name.c_str(), O_RDWR | O_CREAT | O_EXCL, 0600);
+         if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "creating shared schedule failed");
+
+         auto const length = CRON_SHM_RECORD_SIZE * (entries.size() + 1);
+         if (::ftruncate(fd, static_cast<off_t>(length)) < 0)
+         {
+            auto const error = errno;
+            ::close(fd);
+            ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "sizing shared schedule failed");
+         }
+
+         shared_schedule result(fd, length, name, true);
+
+         auto* data = result.data;
+         std::memcpy(data, detail::SHM_MAGIC, sizeof(detail::SHM_MAGIC));
+         detail::store_le(data + 8, CRON_SHM_VERSION, 4);
+         detail::store_le(data + 12, CRON_SHM_RECORD_SIZE, 4);
+         detail::store_le(data + 16, entries.size(), 8);
+         data[24] = detail::dialect_tag<Traits>();
+
+         result.count = entries.size();
+         for (size_t i = 0; i < entries.size(); ++i)
+         {
+            auto* record = result.record(i);
+            detail::store_le(record, entries[i].id, 8);
+            new (record + 8) detail::shm_time(entries[i].next);
+            cron_serialize<Traits>(entries[i].cex, record + 16);
+         }
+
+         new (data + 28) detail::shm_flag(0);
+         result.ready().store(1, std::memory_order_release);
+
+         return result;
+      }
+
+      // Maps an existing segment. Throws std::system_error if it cannot be
+      // opened and std::runtime_error if it is not a complete table written
+      // for these traits.
+      static shared_schedule open(std::string const & name)
+      {
+         int const fd = ::shm_open(name.c_str(), O_RDWR, 0);
+         if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "opening shared schedule failed");
+
+         struct stat info{};
+         if (::fstat(fd, &info) < 0)
+         {
+            auto const error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "reading shared schedule size failed");
+         }
+
+         auto const length = static_cast<size_t>(info.st_size);
+         if (length < CRON_SHM_RECORD_SIZE)
+         {
+            ::close(fd);
+            throw std::runtime_error("Shared schedule is not initialized");
+         }
+
+         shared_schedule result(fd, length, name, false);
+         result.validate();
+         return result;
+      }
+
+      // Removes the name of a segment; mappings stay valid until unmapped.
+      static void remove(std::string const & name) noexcept
+      {
+         ::shm_unlink(name.c_str());
+      }
+
+      shared_schedule(shared_schedule&& other) noexcept :
+         data(other.data),
+         length(other.length),
+         count(other.count)
+      {
+         other.data = nullptr;
+         other.length = 0;
+         other.count = 0;
+      }
+
+      shared_schedule& operator=(shared_schedule&& other) noexcept
+      {
+         if (this != &other)
+         {
+            unmap();
+            data = other.data;
+            length = other.length;
+            count = other.count;
+            other.data = nullptr;
+            other.length = 0;
+            other.count = 0;
+         }
+         return *this;
+      }
+
+      shared_schedule(shared_schedule const &) = delete;
+      shared_schedule& operator=(shared_schedule const &) = delete;
+
+      ~shared_schedule()
+      {
+         unmap();
+      }
+
+      size_t size() const noexcept
+      {
+         return count;
+      }
+
+      std::uint64_t id(size_t const index) const noexcept
+      {
+         return detail::load_le(record(index), 8);
+      }
+
+      // Throws bad_cronexpr if the record is corrupt.
+      cronexpr expression(size_t const index) const
+      {
+         return cron_deserialize<Traits>(record(index) + 16, CRON_BINARY_SIZE);
+      }
+
+      // Position of a job, or size() if the table does not hold it.
+      size_t find(std::uint64_t const job) const noexcept
+      {
+         size_t first = 0;
+         size_t last = count;
+         while (first < last)
+         {
+            auto const middle = first + (last - first) / 2;
+            if (id(middle) < job) first = middle + 1;
+            else last = middle;
+         }
+         return first < count && id(first) == job ? first : count;
+      }
+
+      // Next occurrence not yet claimed, or INVALID_TIME if there is none.
+      std::time_t next(size_t const index) const noexcept
+      {
+         return static_cast<std::time_t>(slot(index).load(std::memory_order_acquire));
+      }
+
+      // Earliest unclaimed occurrence of any job, or INVALID_TIME.
+      std::time_t earliest() const noexcept
+      {
+         auto best = INVALID_TIME;
+         for (size_t i = 0; i < count; ++i)
+         {
+            auto const time = next(i);
+            if (time != INVALID_TIME && (best == INVALID_TIME || time < best))
+               best = time;
+         }
+         return best;
+      }
+
+      // Claims the oldest unclaimed occurrence of a job if it is not later
+      // than now, moving the slot to the following occurrence. Returns the
+      // claimed time, or INVALID_TIME if nothing is due or another worker
+      // claimed it first. Call again to claim further missed occurrences.
+      std::time_t claim(size_t const index, std::time_t const now)
+      {
+         auto& target = slot(index);
+         auto current = target.load(std::memory_order_acquire);
+
+         if (current == INVALID_TIME || current > now)
+            return INVALID_TIME;
+
+         auto const cex = expression(index);
+         while (current != INVALID_TIME && current <= now)
+         {
+            auto const following = static_cast<std::int64_t>(cron_next<Traits>(cex, static_cast<std::time_t>(current)));
+            if (target.compare_exchange_weak(current, following, std::memory_order_acq_rel, std::memory_order_acquire))
+               return static_cast<std::time_t>(current);
+         }
+
+         return INVALID_TIME;
+      }
+
+   private:
+      shared_schedule(int const fd, size_t const size, std::string const & name, bool const created) :
+         length(size)
+      {
+         void* mapped = ::mmap(nullptr, length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+         auto const error = errno;
+         ::close(fd);
+
+         if (mapped == MAP_FAILED)
+         {
+            if (created) ::shm_unlink(name.c_str());
+            throw std::system_error(error, std::generic_category(), "mapping shared schedule failed");
+         }
+
+         data = static_cast<std::uint8_t*>(mapped);
+      }
+
+      void unmap() noexcept
+      {
+         if (data != nullptr)
+            ::munmap(data, length);
+         data = nullptr;
+      }
+
+      std::uint8_t* record(size_t const index) const noexcept
+      {
+         return data + CRON_SHM_RECORD_SIZE * (index + 1);
+      }
+
+      detail::shm_time& slot(size_t const index) const noexcept
+      {
+         return *std::launder(reinterpret_cast<detail::shm_time*>(record(index) + 8));
+      }
+
+      detail::shm_flag& ready() const noexcept
+      {
+         return *std::launder(reinterpret_cast<detail::shm_flag*>(data + 28));
+      }
+
+      // The ready flag is checked first: its acquire load is what makes the
+      // header written by create() visible.
+      void validate()
+      {
+         if (ready().load(std::memory_order_acquire) != 1)
+            throw std::runtime_error("Shared schedule is not initialized");
+         if (std::memcmp(data, detail::SHM_MAGIC, sizeof(detail::SHM_MAGIC)) != 0)
+            throw std::runtime_error("Not a shared schedule");
+         if (detail::load_le(data + 8, 4) != CRON_SHM_VERSION)
+            throw std::runtime_error("Unsupported shared schedule version");
+         if (detail::load_le(data + 12, 4) != CRON_SHM_RECORD_SIZE)
+            throw std::runtime_error("Unsupported shared schedule record size");
+         if (data[24] != detail::dialect_tag<Traits>())
+            throw std::runtime_error("Shared schedule was written for other traits");
+
+         count = static_cast<size_t>(detail::load_le(data + 16, 8));
+         if (length / CRON_SHM_RECORD_SIZE - 1 != count || length % CRON_SHM_RECORD_SIZE != 0)
+            throw std::runtime_error("Shared schedule size does not match its header");
+      }
+
+      std::uint8_t* data = nullptr;
+      size_t length = 0;
+      size_t count = 0;
+   };
+}
+
+#endif
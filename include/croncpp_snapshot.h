@@ -0,0 +1,272 @@
+#pragma once
+
+// POSIX only: snapshot files are written with rename() and read with mmap().
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "croncpp_binary.h"
+
+namespace cron
+{
+   // Snapshot file layout, all words little-endian. A 64-byte header:
+   //
+   //    offset  size  content
+   //         0     8  magic "CRONSNAP"
+   //         8     4  format version
+   //        12     4  record size (64)
+   //        16     8  number of records
+   //        24     1  dialect tag of the traits
+   //
+   // followed by one 64-byte record per job:
+   //
+   //         0     8  job identifier
+   //         8     8  next fire time
+   //        16    45  expression, as written by cron_serialize()
+   constexpr std::uint32_t CRON_SNAPSHOT_VERSION = 1;
+   constexpr size_t CRON_SNAPSHOT_RECORD_SIZE = 64;
+
+   struct snapshot_entry
+   {
+      std::uint64_t id = 0;
+      std::time_t   next = INVALID_TIME;
+      cronexpr      cex;
+   };
+
+   namespace detail
+   {
+      constexpr char SNAPSHOT_MAGIC[8] = { 'C', 'R', 'O', 'N', 'S', 'N', 'A', 'P' };
+
+      inline void write_all(int const fd, std::uint8_t const * data, size_t size)
+      {
+         while (size > 0)
+         {
+            auto const written = ::write(fd, data, size);
+            if (written < 0)
+            {
+               if (errno == EINTR) continue;
+               throw std::system_error(errno, std::generic_category(), "writing snapshot failed");
+            }
+            data += written;
+            size -= static_cast<size_t>(written);
+         }
+      }
+
+      // Creates a file next to path that no other writer, in this process or
+      // another, is using.
+      inline int create_temporary(std::string const & path, std::string& temporary)
+      {
+         static std::atomic<std::uint64_t> sequence{ 0 };
+
+         for (;;)
+         {
+            temporary = path + ".tmp." + std::to_string(::getpid()) + "." + std::to_string(sequence.fetch_add(1));
+
+            int const fd = ::open(temporary.c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0644);
+            if (fd >= 0 || errno != EEXIST)
+               return fd;
+         }
+      }
+
+      // Flushes the directory entry of path, so that a rename() to it
+      // survives a crash.
+      inline void sync_directory(std::string const & path)
+      {
+         auto const slash = path.find_last_of('/');
+         auto const directory =
+            slash == std::string::npos ? std::string(".") :
+            slash == 0 ? std::string("/") : path.substr(0, slash);
+
+         int const fd = ::open(directory.c_str(), O_RDONLY | O_CLOEXEC);
+         if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "opening snapshot directory failed");
+
+         auto const result = ::fsync(fd);
+         auto const error = errno;
+         ::close(fd);
+
+         if (result < 0)
+            throw std::system_error(error, std::generic_category(), "flushing snapshot directory failed");
+      }
+   }
+
+   // Writes a snapshot atomically: the records go to a temporary file in the
+   // same directory, which is flushed to disk and renamed over the target,
+   // so readers see either the old snapshot or the new one. The directory
+   // is flushed after the rename, so the new snapshot survives a crash.
+   // Concurrent writers, even of the same path, use distinct temporary
+   // files; the last rename wins.
+   template <typename Traits = cron_standard_traits>
+   static void write_snapshot(std::string const & path, std::vector<snapshot_entry> const & entries)
+   {
+      std::vector<std::uint8_t> data(CRON_SNAPSHOT_RECORD_SIZE * (entries.size() + 1), 0);
+
+      std::memcpy(data.data(), detail::SNAPSHOT_MAGIC, sizeof(detail::SNAPSHOT_MAGIC));
+      detail::store_le(data.data() + 8, CRON_SNAPSHOT_VERSION, 4);
+      detail::store_le(data.data() + 12, CRON_SNAPSHOT_RECORD_SIZE, 4);
+      detail::store_le(data.data() + 16, entries.size(), 8);
+      data[24] = detail::dialect_tag<Traits>();
+
+      auto* record = data.data() + CRON_SNAPSHOT_RECORD_SIZE;
+      for (auto const & entry : entries)
+      {
+         detail::store_le(record, entry.id, 8);
+         detail::store_le(record + 8, static_cast<std::uint64_t>(entry.next), 8);
+         cron_serialize<Traits>(entry.cex, record + 16);
+         record += CRON_SNAPSHOT_RECORD_SIZE;
+      }
+
+      std::string temporary;
+      int const fd = detail::create_temporary(path, temporary);
+      if (fd < 0)
+         throw std::system_error(errno, std::generic_category(), "creating snapshot failed");
+
+      try
+      {
+         detail::write_all(fd, data.data(), data.size());
+         if (::fsync(fd) < 0)
+            throw std::system_error(errno, std::generic_category(), "flushing snapshot failed");
+      }
+      catch (...)
+      {
+         ::close(fd);
+         ::unlink(temporary.c_str());
+         throw;
+      }
+
+      ::close(fd);
+
+      if (::rename(temporary.c_str(), path.c_str()) < 0)
+      {
+         auto const error = errno;
+         ::unlink(temporary.c_str());
+         throw std::system_error(error, std::generic_category(), "replacing snapshot failed");
+      }
+
+      detail::sync_directory(path);
+   }
+
+   // Read-only view of a snapshot file mapped in memory. Opening it only
+   // checks the header; records are decoded when accessed. The pages are
+   // shared by every process mapping the same file.
+   template <typename Traits = cron_standard_traits>
+   class snapshot_view
+   {
+   public:
+      explicit snapshot_view(std::string const & path)
+      {
+         int const fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+         if (fd < 0)
+            throw std::system_error(errno, std::generic_category(), "opening snapshot failed");
+
+         struct stat info{};
+         if (::fstat(fd, &info) < 0)
+         {
+            auto const error = errno;
+            ::close(fd);
+            throw std::system_error(error, std::generic_category(), "reading snapshot size failed");
+         }
+
+         length = static_cast<size_t>(info.st_size);
+         if (length < CRON_SNAPSHOT_RECORD_SIZE)
+         {
+            ::close(fd);
+            throw std::runtime_error("Snapshot file is truncated");
+         }
+
+         void* mapped = ::mmap(nullptr, length, PROT_READ, MAP_SHARED, fd, 0);
+         auto const error = errno;
+         ::close(fd);
+
+         if (mapped == MAP_FAILED)
+            throw std::system_error(error, std::generic_category(), "mapping snapshot failed");
+
+         data = static_cast<std::uint8_t const *>(mapped);
+
+         try
+         {
+            validate();
+         }
+         catch (...)
+         {
+            ::munmap(const_cast<std::uint8_t*>(data), length);
+            throw;
+         }
+      }
+
+      ~snapshot_view()
+      {
+         ::munmap(const_cast<std::uint8_t*>(data), length);
+      }
+
+      snapshot_view(snapshot_view const &) = delete;
+      snapshot_view& operator=(snapshot_view const &) = delete;
+
+      size_t size() const noexcept
+      {
+         return count;
+      }
+
+      std::uint64_t id(size_t const index) const noexcept
+      {
+         return detail::load_le(record(index), 8);
+      }
+
+      std::time_t next(size_t const index) const noexcept
+      {
+         return static_cast<std::time_t>(detail::load_le(record(index) + 8, 8));
+      }
+
+      // Throws bad_cronexpr if the record is corrupt.
+      cronexpr expression(size_t const index) const
+      {
+         return cron_deserialize<Traits>(record(index) + 16, CRON_BINARY_SIZE);
+      }
+
+      snapshot_entry operator[](size_t const index) const
+      {
+         return snapshot_entry{ id(index), next(index), expression(index) };
+      }
+
+   private:
+      std::uint8_t const * record(size_t const index) const noexcept
+      {
+         return data + CRON_SNAPSHOT_RECORD_SIZE * (index + 1);
+      }
+
+      void validate()
+      {
+         if (std::memcmp(data, detail::SNAPSHOT_MAGIC, sizeof(detail::SNAPSHOT_MAGIC)) != 0)
+            throw std::runtime_error("Not a snapshot file");
+         if (detail::load_le(data + 8, 4) != CRON_SNAPSHOT_VERSION)
+            throw std::runtime_error("Unsupported snapshot version");
+         if (detail::load_le(data + 12, 4) != CRON_SNAPSHOT_RECORD_SIZE)
+            throw std::runtime_error("Unsupported snapshot record size");
+         if (data[24] != detail::dialect_tag<Traits>())
+            throw std::runtime_error("Snapshot was written for other traits");
+
+         count = static_cast<size_t>(detail::load_le(data + 16, 8));
+         if (length / CRON_SNAPSHOT_RECORD_SIZE - 1 != count || length % CRON_SNAPSHOT_RECORD_SIZE != 0)
+            throw std::runtime_error("Snapshot file size does not match its header");
+      }
+
+      std::uint8_t const * data = nullptr;
+      size_t length = 0;
+      size_t count = 0;
+   };
+}
+
+#endif
@@ -0,0 +1,181 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <ctime>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include "croncpp_scheduler.h"
+
+namespace cron
+{
+   struct table_entry
+   {
+      job_id   id = INVALID_JOB;
+      cronexpr cex;
+   };
+
+   // Set of expressions keyed by job identifier that never changes once
+   // built, so any number of threads may read it without synchronization.
+   template <typename Traits = cron_standard_traits>
+   class schedule_table
+   {
+   public:
+      using const_iterator = typename std::vector<table_entry>::const_iterator;
+
+      // Throws std::invalid_argument if an identifier appears twice.
+      schedule_table(std::vector<table_entry> entries, std::uint64_t const version) :
+         entries(std::move(entries)),
+         table_version(version)
+      {
+         std::sort(this->entries.begin(), this->entries.end(),
+            [](table_entry const & a, table_entry const & b) { return a.id < b.id; });
+
+         auto const duplicate = std::adjacent_find(this->entries.begin(), this->entries.end(),
+            [](table_entry const & a, table_entry const & b) { return a.id == b.id; });
+         if (duplicate != this->entries.end())
+            throw std::invalid_argument("Duplicate job identifier in schedule table");
+      }
+
+      std::uint64_t version() const noexcept
+      {
+         return table_version;
+      }
+
+      size_t size() const noexcept
+      {
+         return entries.size();
+      }
+
+      const_iterator begin() const noexcept
+      {
+         return entries.begin();
+      }
+
+      const_iterator end() const noexcept
+      {
+         return entries.end();
+      }
+
+      // The expression of a job, or nullptr if the table does not hold it.
+      cronexpr const * find(job_id const id) const noexcept
+      {
+         auto const it = std::lower_bound(entries.begin(), entries.end(), id,
+            [](table_entry const & entry, job_id const key) { return entry.id < key; });
+         return it != entries.end() && it->id == id ? &it->cex : nullptr;
+      }
+
+      // Next occurrence of a job after the given time, or INVALID_TIME if
+      // the table does not hold it or it never fires again.
+      std::time_t next(job_id const id, std::time_t const after) const
+      {
+         auto const cex = find(id);
+         return cex == nullptr ? INVALID_TIME : cron_next<Traits>(*cex, after);
+      }
+
+      // The job firing first after the given time and when, or INVALID_JOB
+      // and INVALID_TIME if none fires again.
+      std::pair<job_id, std::time_t> earliest(std::time_t const after) const
+      {
+         std::pair<job_id, std::time_t> best{ INVALID_JOB, INVALID_TIME };
+         for (auto const & entry : entries)
+         {
+            auto const time = cron_next<Traits>(entry.cex, after);
+            if (time != INVALID_TIME && (best.second == INVALID_TIME || time < best.second))
+               best = { entry.id, time };
+         }
+         return best;
+      }
+
+   private:
+      std::vector<table_entry> entries;
+      std::uint64_t            table_version;
+   };
+
+   // Publishes successive versions of a schedule table, read-copy-update
+   // style. snapshot() returns the current version, which stays valid and
+   // unchanged for as long as the reader holds it, whatever is published
+   // meanwhile. A new version is built aside and installed with an atomic
+   // pointer swap, so readers never wait for it. The last holder of a
+   // replaced version frees it. Writers are serialized among themselves.
+   template <typename Traits = cron_standard_traits>
+   class schedule_publisher
+   {
+   public:
+      using table = schedule_table<Traits>;
+      using snapshot_type = std::shared_ptr<table const>;
+
+      schedule_publisher() :
+         schedule_publisher(std::vector<table_entry>{})
+      {
+      }
+
+      explicit schedule_publisher(std::vector<table_entry> entries) :
+         current(std::make_shared<table const>(std::move(entries), 1))
+      {
+      }
+
+      schedule_publisher(schedule_publisher const &) = delete;
+      schedule_publisher& operator=(schedule_publisher const &) = delete;
+
+      snapshot_type snapshot() const noexcept
+      {
+#ifdef __cpp_lib_atomic_shared_ptr
+         return current.load(std::memory_order_acquire);
+#else
+         return std::atomic_load_explicit(&current, std::memory_order_acquire);
+#endif
+      }
+
+      std::uint64_t version() const noexcept
+      {
+         return snapshot()->version();
+      }
+
+      // Replaces the table and returns its version.
+      std::uint64_t publish(std::vector<table_entry> entries)
+      {
+         std::lock_guard<std::mutex> lock(writer);
+         return install(std::move(entries));
+      }
+
+      // Publishes a copy of the current entries changed by edit, which is
+      // called with a std::vector<table_entry>&. Returns the new version.
+      template <typename F>
+      std::uint64_t modify(F&& edit)
+      {
+         std::lock_guard<std::mutex> lock(writer);
+
+         auto const old = snapshot();
+         std::vector<table_entry> entries(old->begin(), old->end());
+         edit(entries);
+         return install(std::move(entries));
+      }
+
+   private:
+      std::uint64_t install(std::vector<table_entry> entries)
+      {
+         auto const version = snapshot()->version() + 1;
+         auto next = std::make_shared<table const>(std::move(entries), version);
+
+#ifdef __cpp_lib_atomic_shared_ptr
+         current.store(std::move(next), std::memory_order_release);
+#else
+         std::atomic_store_explicit(&current, std::move(next), std::memory_order_release);
+#endif
+         return version;
+      }
+
+#ifdef __cpp_lib_atomic_shared_ptr
+      std::atomic<snapshot_type> current;
+#else
+      snapshot_type              current;
+#endif
+      std::mutex                 writer;
+   };
+}
@@ -0,0 +1,204 @@
+#pragma once
+
+// Linux only: drives a scheduler from a timerfd that can be watched by epoll.
+#ifdef __linux__
+
+#include <cerrno>
+#include <cstdint>
+#include <ctime>
+#include <system_error>
+
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <unistd.h>
+
+#include "croncpp_scheduler.h"
+
+#ifndef TFD_TIMER_CANCEL_ON_SET
+#define TFD_TIMER_CANCEL_ON_SET (1 << 1)
+#endif
+
+namespace cron
+{
+   // Arms a single CLOCK_REALTIME timerfd at the next wakeup of a scheduler:
+   // its earliest deadline, postponed as far as the job tolerances allow.
+   // The descriptor becomes readable when that deadline is reached, or when
+   // the system clock is set, so it can be added to an existing epoll (or
+   // poll/select) loop. When it is readable, call
+   // on_readable(): it advances the scheduler and re-arms the timer.
+   // The timer is only reprogrammed when the wakeup moment changes.
+   // Call arm() after adding, updating or cancelling jobs on the loop thread.
+   // Other threads use the post_ functions of the driver, or post to the
+   // scheduler and call notify(): both signal an eventfd, event_fd(), that
+   // the loop watches next to fd() and handles with the same on_readable(),
+   // so the commands take effect without waiting for the timer.
+   template <typename Scheduler>
+   class timerfd_driver
+   {
+   public:
+      using callback = typename Scheduler::callback;
+
+      explicit timerfd_driver(Scheduler& sched) :
+         sched(sched),
+         timer(::timerfd_create(CLOCK_REALTIME, TFD_NONBLOCK | TFD_CLOEXEC)),
+         event(::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+      {
+         if (timer < 0 || event < 0)
+         {
+            auto const error = errno;
+            if (timer >= 0) ::close(timer);
+            throw std::system_error(error, std::generic_category(), timer < 0 ? "timerfd_create failed" : "eventfd failed");
+         }
+      }
+
+      ~timerfd_driver()
+      {
+         ::close(event);
+         ::close(timer);
+      }
+
+      timerfd_driver(timerfd_driver const &) = delete;
+      timerfd_driver& operator=(timerfd_driver const &) = delete;
+
+      int fd() const noexcept
+      {
+         return timer;
+      }
+
+      // Readable when commands were posted through the driver or notify()
+      // was called.
+      int event_fd() const noexcept
+      {
+         return event;
+      }
+
+      // May be called from any thread: wakes the loop so that it applies the
+      // commands posted to the scheduler.
+      void notify() noexcept
+      {
+         std::uint64_t const one = 1;
+         [[maybe_unused]] auto const written = ::write(event, &one, sizeof(one));
+      }
+
+      job_id post_add(cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         auto const id = sched.post_add(cex, std::move(fn), options);
+         notify();
+         return id;
+      }
+
+      void post_insert(job_id const id, cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         sched.post_insert(id, cex, std::move(fn), options);
+         notify();
+      }
+
+      void post_update(job_id const id, cronexpr const & cex)
+      {
+         sched.post_update(id, cex);
+         notify();
+      }
+
+      void post_upsert(job_id const id, cronexpr const & cex, callback fn, job_options const & options = {})
+      {
+         sched.post_upsert(id, cex, std::move(fn), options);
+         notify();
+      }
+
+      void post_cancel(job_id const id)
+      {
+         sched.post_cancel(id);
+         notify();
+      }
+
+      // Programs the timer for the next wakeup, unless it already is.
+      void arm()
+      {
+         auto const next = sched.next_wakeup();
+         if (next == armed) return;
+
+         program(next);
+      }
+
+      // Handles a readable descriptor, either of them: applies the posted
+      // commands, fires the due jobs and re-arms the timer. Returns the
+      // number of fired jobs.
+      size_t on_readable()
+      {
+         std::uint64_t signals = 0;
+         if (::read(event, &signals, sizeof(signals)) == sizeof(signals))
+            ++notifications;
+
+         std::uint64_t expirations = 0;
+         if (::read(timer, &expirations, sizeof(expirations)) == sizeof(expirations))
+         {
+            // a one-shot timer is disarmed once it expires
+            armed = INVALID_TIME;
+         }
+         else
+         {
+            if (errno == ECANCELED)
+            {
+               // the clock was set: the absolute deadline must be reprogrammed
+               ++clock_changes;
+               armed = INVALID_TIME;
+            }
+            else if (errno != EAGAIN && errno != EINTR)
+            {
+               throw std::system_error(errno, std::generic_category(), "reading timerfd failed");
+            }
+         }
+
+         auto const fired = sched.tick();
+         arm();
+
+         return fired;
+      }
+
+      std::time_t deadline() const noexcept
+      {
+         return armed;
+      }
+
+      size_t rearm_count() const noexcept
+      {
+         return rearms;
+      }
+
+      size_t clock_change_count() const noexcept
+      {
+         return clock_changes;
+      }
+
+      // Number of on_readable() calls that found the eventfd signalled.
+      size_t notification_count() const noexcept
+      {
+         return notifications;
+      }
+
+   private:
+      void program(std::time_t const next)
+      {
+         itimerspec spec{};
+         if (INVALID_TIME != next)
+            spec.it_value.tv_sec = next;
+
+         // a zero it_value disarms the timer
+         if (::timerfd_settime(timer, TFD_TIMER_ABSTIME | TFD_TIMER_CANCEL_ON_SET, &spec, nullptr) < 0)
+            throw std::system_error(errno, std::generic_category(), "timerfd_settime failed");
+
+         armed = next;
+         ++rearms;
+      }
+
+      Scheduler& sched;
+      int const timer;
+      int const event;
+      std::time_t armed = INVALID_TIME;
+      size_t rearms = 0;
+      size_t clock_changes = 0;
+      size_t notifications = 0;
+   };
+}
+
+#endif
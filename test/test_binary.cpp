@@ -0,0 +1,75 @@
+#include "catch.hpp"
+#include "croncpp_binary.h"
+
+#include <string>
+#include <vector>
+
+using namespace cron;
+
+namespace
+{
+   template <typename Traits>
+   void check_roundtrip(std::string_view expr)
+   {
+      auto const cex = make_cron<Traits>(expr);
+      auto const data = cron_serialize<Traits>(cex);
+      auto const copy = cron_deserialize<Traits>(data);
+
+      INFO(expr);
+      REQUIRE(to_string(copy) == to_string(cex));
+      REQUIRE(cron_serialize<Traits>(copy) == data);
+   }
+}
+
+TEST_CASE("binary: roundtrip", "[binary]")
+{
+   for (auto expr : { "* * * * * *", "0 0 0 1 1 *", "*/7 5-10 3,15 ? JAN-MAR SUN", "59 59 23 31 12 SAT" })
+      check_roundtrip<cron_standard_traits>(expr);
+
+   for (auto expr : { "* * * * * *", "0 0 12 ? JAN MON-FRI", "0 30 23 30 1/3 ?" })
+      check_roundtrip<cron_oracle_traits>(expr);
+
+   for (auto expr : { "0 0 12 * * ?", "0 0 0 1 1 ? 2099", "0 0 0 1 1 ? 1970,2040-2060/5" })
+      check_roundtrip<cron_quartz_traits>(expr);
+}
+
+TEST_CASE("binary: layout is little-endian", "[binary]")
+{
+   auto const data = cron_serialize(make_cron("1 0 23 1 DEC SUN"));
+
+   REQUIRE(data[0] == CRON_BINARY_VERSION);
+   REQUIRE(data[1] == 1);
+   REQUIRE(data[2] == 0x02);
+   REQUIRE(data[10] == 0x01);
+   REQUIRE(data[20] == 0x80);
+   REQUIRE(data[21] == 0x01);
+   REQUIRE(data[22] == 0x01);
+   REQUIRE(data[26] == 0x00);
+   REQUIRE(data[27] == 0x08);
+}
+
+TEST_CASE("binary: rejects invalid data", "[binary]")
+{
+   auto const valid = cron_serialize(make_cron("0 0 12 * * *"));
+
+   auto with = [&valid](size_t const index, std::uint8_t const value) {
+      auto copy = valid;
+      copy[index] = value;
+      return copy;
+   };
+
+   REQUIRE_THROWS_AS(cron_deserialize(valid.data(), valid.size() - 1), bad_cronexpr);
+   REQUIRE_THROWS_AS(cron_deserialize(with(0, 2)), bad_cronexpr);
+   REQUIRE_THROWS_AS(cron_deserialize<cron_quartz_traits>(valid), bad_cronexpr);
+
+   REQUIRE_THROWS_AS(cron_deserialize(with(9, 0x10)), bad_cronexpr);   // second 60
+   REQUIRE_THROWS_AS(cron_deserialize(with(21, 0xff)), bad_cronexpr);  // weekday 7
+   REQUIRE_THROWS_AS(cron_deserialize(with(25, 0x80)), bad_cronexpr);  // day 32
+   REQUIRE_THROWS_AS(cron_deserialize(with(27, 0x10)), bad_cronexpr);  // month 13
+   REQUIRE_THROWS_AS(cron_deserialize(with(30, 0x01)), bad_cronexpr);  // year without year field
+   REQUIRE_THROWS_AS(cron_deserialize(with(2, 0x00)), bad_cronexpr);   // no second
+
+   auto quartz = cron_serialize<cron_quartz_traits>(make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2099"));
+   quartz[44] |= 0x04;
+   REQUIRE_THROWS_AS(cron_deserialize<cron_quartz_traits>(quartz), bad_cronexpr);
+}
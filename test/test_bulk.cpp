@@ -0,0 +1,77 @@
+#include "catch.hpp"
+#include "croncpp_bulk.h"
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+using namespace cron;
+
+namespace
+{
+   std::vector<std::string> make_expressions(size_t const count)
+   {
+      std::vector<std::string> result;
+      result.reserve(count);
+
+      for (size_t i = 0; i < count; ++i)
+      {
+         if (i % 997 == 0)
+            result.push_back("0 0 " + std::to_string(24 + i % 7) + " * * *");
+         else
+            result.push_back(std::to_string(i % 60) + " */" + std::to_string(1 + i % 30) + " " +
+                             std::to_string(i % 24) + " * JAN-JUN MON-FRI");
+      }
+
+      return result;
+   }
+}
+
+TEST_CASE("bulk: parallel parse matches serial parse", "[bulk]")
+{
+   auto const texts = make_expressions(10000);
+   std::vector<std::string_view> exprs(texts.begin(), texts.end());
+
+   std::vector<cronexpr> serial;
+   std::vector<parse_error> serial_errors;
+   auto const serial_parsed = parse_all(exprs, serial, serial_errors, 1);
+
+   for (size_t threads : { 2, 4, 16 })
+   {
+      std::vector<cronexpr> parallel;
+      std::vector<parse_error> parallel_errors;
+      INFO(threads);
+
+      REQUIRE(parse_all(exprs, parallel, parallel_errors, threads) == serial_parsed);
+      REQUIRE(parallel == serial);
+      REQUIRE(parallel_errors.size() == serial_errors.size());
+      for (size_t i = 0; i < parallel_errors.size(); ++i)
+      {
+         REQUIRE(parallel_errors[i].index == serial_errors[i].index);
+         REQUIRE(parallel_errors[i].message == serial_errors[i].message);
+      }
+   }
+
+   REQUIRE(serial_errors.size() == (10000 + 996) / 997);
+   REQUIRE(serial_parsed + serial_errors.size() == exprs.size());
+   for (auto const & e : serial_errors)
+   {
+      REQUIRE(e.index % 997 == 0);
+      REQUIRE(serial[e.index] == cronexpr{});
+   }
+   REQUIRE(serial[1] == make_cron(texts[1]));
+}
+
+TEST_CASE("bulk: empty and small inputs", "[bulk]")
+{
+   std::vector<cronexpr> out;
+   std::vector<parse_error> errors;
+
+   REQUIRE(parse_all(std::vector<std::string_view>{}, out, errors) == 0);
+   REQUIRE(out.empty());
+
+   REQUIRE(parse_all<cron_quartz_traits>({ "0 0 12 ? * MON 2030", "bad" }, out, errors, 8) == 1);
+   REQUIRE(out[0] == make_cron<cron_quartz_traits>("0 0 12 ? * MON 2030"));
+   REQUIRE(errors.size() == 1);
+   REQUIRE(errors[0].index == 1);
+}
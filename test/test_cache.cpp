@@ -0,0 +1,71 @@
+#include "catch.hpp"
+#include "croncpp_cache.h"
+
+#include <thread>
+#include <vector>
+
+using namespace cron;
+
+TEST_CASE("cache: hits and misses", "[cache]")
+{
+   cron_cache<> cache(16, 4);
+
+   auto cex1 = cache.get("0 0 * * * *");
+   auto cex2 = cache.get("0 0 * * * *");
+
+   REQUIRE(cex1 == make_cron("0 0 * * * *"));
+   REQUIRE(cex1 == cex2);
+   REQUIRE(cache.misses() == 1);
+   REQUIRE(cache.hits() == 1);
+   REQUIRE(cache.size() == 1);
+
+   cache.clear();
+   REQUIRE(cache.size() == 0);
+}
+
+TEST_CASE("cache: invalid expressions are not cached", "[cache]")
+{
+   cron_cache<> cache;
+
+   REQUIRE_THROWS_AS(cache.get("60 * * * * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(cache.get("60 * * * * *"), bad_cronexpr);
+   REQUIRE(cache.size() == 0);
+   REQUIRE(cache.misses() == 2);
+}
+
+TEST_CASE("cache: size limit", "[cache]")
+{
+   cron_cache<> cache(8, 2);
+
+   for (int i = 0; i < 60; ++i)
+      cache.get(std::to_string(i) + " * * * * *");
+
+   REQUIRE(cache.size() <= cache.capacity());
+   REQUIRE(cache.capacity() == 8);
+}
+
+TEST_CASE("cache: traits", "[cache]")
+{
+   cron_cache<cron_quartz_traits> cache;
+
+   REQUIRE(cache.get("0 0 12 ? * MON 2030") == make_cron<cron_quartz_traits>("0 0 12 ? * MON 2030"));
+   REQUIRE(make_cron_cached("*/5 * * * * *") == make_cron("*/5 * * * * *"));
+}
+
+TEST_CASE("cache: concurrent access", "[cache]")
+{
+   cron_cache<> cache(256, 8);
+
+   std::vector<std::thread> threads;
+   for (int t = 0; t < 4; ++t)
+   {
+      threads.emplace_back([&cache]() {
+         for (int i = 0; i < 1000; ++i)
+            cache.get(std::to_string(i % 20) + " * * * * *");
+      });
+   }
+   for (auto & t : threads) t.join();
+
+   REQUIRE(cache.hits() + cache.misses() == 4000);
+   REQUIRE(cache.size() == 20);
+}
@@ -0,0 +1,113 @@
+#include "catch.hpp"
+#include "croncpp_coro.h"
+#include "test_helpers.h"
+
+#if defined(__cpp_impl_coroutine) && __has_include(<coroutine>)
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   struct detached_task
+   {
+      struct promise_type
+      {
+         detached_task get_return_object() noexcept { return {}; }
+         std::suspend_never initial_suspend() noexcept { return {}; }
+         std::suspend_never final_suspend() noexcept { return {}; }
+         void return_void() noexcept {}
+         void unhandled_exception() { std::terminate(); }
+      };
+   };
+
+   std::time_t precise_now()
+   {
+      return std::chrono::system_clock::to_time_t(std::chrono::system_clock::now());
+   }
+
+   template <typename Traits = cron_standard_traits>
+   detached_task wait_once(cronexpr cex, timer_service& service, std::atomic<std::time_t>& result)
+   {
+      result = co_await next_fire<Traits>(cex, service);
+   }
+
+   detached_task wait_in_loop(cronexpr cex, timer_service& service, std::atomic<int>& count, std::atomic<bool>& increasing)
+   {
+      std::time_t previous = 0;
+      for (int i = 0; i < 3; ++i)
+      {
+         auto const when = co_await next_fire(cex, service);
+         if (when <= previous) increasing = false;
+         previous = when;
+         ++count;
+      }
+   }
+
+   detached_task wait_twice(cronexpr cex, timer_service& service, std::atomic<int>& count, std::atomic<bool>& ordered)
+   {
+      occurrences<> ticks(cex, std::time(nullptr), service);
+
+      auto const first = co_await ticks.next();
+      ++count;
+      auto const second = co_await ticks.next();
+      ordered = second == first + 1 && precise_now() >= second;
+      ++count;
+   }
+}
+
+TEST_CASE("coroutines: resume at the next occurrence", "[coro]")
+{
+   timer_service service;
+   auto const cex = make_cron("* * * * * *");
+
+   std::atomic<std::time_t> result{ 0 };
+   std::atomic<int> count{ 0 };
+   std::atomic<bool> ordered{ false };
+
+   auto const before = std::time(nullptr);
+   wait_once(cex, service, result);
+   wait_twice(cex, service, count, ordered);
+   REQUIRE(service.pending() == 2);
+
+   REQUIRE(wait_until([&]() { return result != 0 && count == 2; }));
+   REQUIRE(result > before);
+   REQUIRE(precise_now() >= result);
+   REQUIRE(ordered);
+   REQUIRE(service.pending() == 0);
+}
+
+TEST_CASE("coroutines: executor hook and exhausted expressions", "[coro]")
+{
+   timer_service service;
+   std::atomic<int> hooked{ 0 };
+   service.set_executor([&hooked](std::function<void()> resume) { ++hooked; resume(); });
+
+   std::atomic<std::time_t> result{ 0 };
+   wait_once(make_cron("* * * * * *"), service, result);
+   REQUIRE(wait_until([&]() { return result != 0; }));
+   REQUIRE(hooked == 1);
+
+   std::atomic<std::time_t> never{ 0 };
+   wait_once<cron_quartz_traits>(make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2020"), service, never);
+   REQUIRE(never == INVALID_TIME);
+   REQUIRE(service.pending() == 0);
+}
+
+TEST_CASE("coroutines: awaiting next_fire in a loop moves forward", "[coro]")
+{
+   timer_service service;
+   std::atomic<int> count{ 0 };
+   std::atomic<bool> increasing{ true };
+
+   wait_in_loop(make_cron("* * * * * *"), service, count, increasing);
+
+   REQUIRE(wait_until([&]() { return count == 3; }));
+   REQUIRE(increasing);
+}
+
+#endif
@@ -0,0 +1,308 @@
+#include "catch.hpp"
+#include "croncpp_count.h"
+#include "test_helpers.h"
+
+#include <string>
+#include <vector>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   template <typename Traits>
+   std::vector<std::uint64_t> enumerate_forecast(
+      std::vector<cronexpr> const & expressions,
+      std::time_t const from,
+      std::time_t const to,
+      std::time_t const bucket)
+   {
+      std::vector<std::uint64_t> histogram(static_cast<size_t>((to - from + bucket - 1) / bucket), 0);
+      for (auto const & cex : expressions)
+      {
+         for (auto t = cron_next<Traits>(cex, from - 1); t != INVALID_TIME && t < to; t = cron_next<Traits>(cex, t))
+            ++histogram[static_cast<size_t>((t - from) / bucket)];
+      }
+      return histogram;
+   }
+
+   std::uint64_t enumerate_count(cronexpr const & cex, std::time_t const from, std::time_t const to)
+   {
+      std::uint64_t count = 0;
+      for (auto t = cron_next(cex, from); t != INVALID_TIME && t <= to; t = cron_next(cex, t))
+         ++count;
+      return count;
+   }
+}
+
+TEST_CASE("count: civil calendar conversions", "[count]")
+{
+   REQUIRE(detail::days_from_civil(1970, 1, 1) == 0);
+   REQUIRE(detail::days_from_civil(2000, 3, 1) == 11017);
+   REQUIRE(detail::days_from_civil(1969, 12, 31) == -1);
+   REQUIRE(detail::weekday_from_days(0) == 4);
+   REQUIRE(detail::weekday_from_days(-1) == 3);
+
+   for (std::int64_t day = -800; day < 30000; day += 37)
+   {
+      auto const date = detail::civil_from_days(day);
+      REQUIRE(detail::days_from_civil(date.year, date.month, date.day) == day);
+   }
+}
+
+TEST_CASE("count: forecast matches enumeration", "[count]")
+{
+   std::vector<cronexpr> expressions =
+   {
+      make_cron("0 0 * * * *"), make_cron("*/20 * 0,12 * * *"), make_cron("30 */7 9-17 * * MON-FRI"),
+      make_cron("0 0 0 1 * *"), make_cron("15,45 5 3 * * SUN"), make_cron("* * 23 * * *"),
+   };
+
+   auto const from = local_time("2021-02-26 21:17:43");
+   auto const to = from + 4 * 86400 + 1234;
+
+   for (std::time_t bucket : { 1, 7, 60, 90, 3600, 5000, 86400 })
+      REQUIRE(cron_forecast(expressions, from, to, bucket) == enumerate_forecast<cron_standard_traits>(expressions, from, to, bucket));
+
+   REQUIRE(cron_forecast(expressions, to, from, 60).empty());
+   REQUIRE(cron_forecast(expressions, from, to, 0).empty());
+}
+
+TEST_CASE("count: forecast honours years", "[count]")
+{
+   std::vector<cronexpr> expressions = { make_cron<cron_quartz_traits>("0 0 12 * * ? 2022") };
+
+   auto const from = local_time("2021-12-30 00:00:00");
+   auto const histogram = cron_forecast<cron_quartz_traits>(expressions, from, from + 4 * 86400, 86400);
+   REQUIRE(histogram == std::vector<std::uint64_t>{ 0, 0, 1, 1 });
+}
+
+TEST_CASE("count: matches enumeration", "[count]")
+{
+   std::vector<std::string> expressions =
+   {
+      "0 0 * * * *", "*/20 * 0,12 * * *", "30 */7 9-17 * * MON-FRI", "0 0 0 1 * *",
+      "15,45 5 3 * * SUN", "0 0 0 29 2 *", "0 30 23 31 * FRI", "0 0 12 ? 1/3 *",
+   };
+
+   std::vector<std::pair<std::time_t, std::time_t>> windows =
+   {
+      { local_time("2021-02-26 21:17:43"), local_time("2021-02-26 23:59:59") },
+      { local_time("2021-02-26 21:17:43"), local_time("2021-03-02 09:30:30") },
+      { local_time("2019-12-31 12:00:00"), local_time("2020-03-05 00:00:00") },
+      { local_time("2021-03-01 00:00:00"), local_time("2021-03-01 00:00:00") },
+   };
+
+   for (auto const & expr : expressions)
+   {
+      auto const cex = make_cron(expr);
+      for (auto const & [from, to] : windows)
+      {
+         INFO(expr);
+         REQUIRE(cron_count(cex, from, to) == enumerate_count(cex, from, to));
+      }
+   }
+}
+
+TEST_CASE("count: matches enumeration across DST transitions", "[count]")
+{
+   std::vector<std::string> expressions =
+   {
+      "0 0 * * * *", "0 */20 * * * *", "0 15 */2 * * *", "30 */7 9-17 * * MON-FRI",
+      "0 0 0 1 * *", "15,45 5 3 * * SUN", "0 0 12 ? 1/3 *",
+   };
+
+   struct zone_windows
+   {
+      char const *  zone;
+      char const *  spring[2];
+      char const *  fall[2];
+   };
+
+   zone_windows const zones[] =
+   {
+      { "EST5EDT,M3.2.0,M11.1.0", { "2021-03-13 12:00:00", "2021-03-15 12:00:00" }, { "2021-11-01 00:00:00", "2021-11-10 00:00:00" } },
+      { "CET-1CEST,M3.5.0,M10.5.0/3", { "2021-03-27 12:00:00", "2021-03-29 12:00:00" }, { "2021-10-25 00:00:00", "2021-11-03 00:00:00" } },
+   };
+
+   for (auto const & z : zones)
+   {
+      scoped_time_zone const zone(z.zone);
+      INFO(z.zone);
+
+      auto const spring_from = local_time(z.spring[0]);
+      auto const spring_to = local_time(z.spring[1]);
+      auto const fall_from = local_time(z.fall[0]);
+      auto const fall_to = local_time(z.fall[1]);
+
+      // the skipped hour has no fire, the repeated one fires twice
+      auto const hourly = make_cron("0 0 * * * *");
+      REQUIRE(cron_count(hourly, spring_from, spring_to) == 47);
+      REQUIRE(cron_count(hourly, fall_from, fall_to) == 217);
+
+      for (auto const & expr : expressions)
+      {
+         INFO(expr);
+         auto const cex = make_cron(expr);
+         REQUIRE(cron_count(cex, spring_from, spring_to) == enumerate_count(cex, spring_from, spring_to));
+         REQUIRE(cron_count(cex, fall_from, fall_to) == enumerate_count(cex, fall_from, fall_to));
+      }
+   }
+}
+
+TEST_CASE("count: long ranges", "[count]")
+{
+   auto const from = local_time("2000-01-01 00:00:00");
+   auto const to = local_time("2100-01-01 00:00:00");
+
+   REQUIRE(cron_count(make_cron("* * * * * *"), from, to) == 36525ull * 86400);
+   REQUIRE(cron_count(make_cron("0 0 0 29 2 *"), from, to) == 25);
+   REQUIRE(cron_count(make_cron("0 0 0 13 * FRI"), from, to) == 172);
+   REQUIRE(cron_count(make_cron("0 0 0 13 * FRI"), to, from) == 0);
+
+   REQUIRE(cron_count<cron_quartz_traits>(make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2050-2059"), from, to) == 10);
+}
+
+TEST_CASE("count: ordinal and nth occurrence", "[count]")
+{
+   std::vector<std::string> expressions =
+   {
+      "0 0 * * * *", "*/20 * 0,12 * * *", "30 */7 9-17 * * MON-FRI", "0 0 0 29 2 *", "15,45 5 3 * * SUN",
+   };
+
+   auto const reference = local_time("2021-02-26 21:17:43");
+
+   for (auto const & expr : expressions)
+   {
+      INFO(expr);
+      auto const cex = make_cron(expr);
+
+      auto t = reference;
+      for (std::uint64_t k = 1; k <= 40; ++k)
+      {
+         // cron_next() gives up across the eight years without 29 February around 2100
+         t = cron_next(cex, t);
+         if (t == INVALID_TIME) break;
+
+         REQUIRE(cron_nth(cex, reference, k) == t);
+         REQUIRE(cron_ordinal(cex, reference, t) == k);
+         REQUIRE(cron_ordinal(cex, reference, t + 1) >= k);
+      }
+   }
+
+   auto const hourly = make_cron("0 0 * * * *");
+   auto const later = cron_nth(hourly, reference, 1000000);
+   REQUIRE(cron_ordinal(hourly, reference, later) == 1000000);
+   REQUIRE(cron_ordinal(hourly, reference, later - 1) == 999999);
+
+   REQUIRE(cron_nth(hourly, reference, 0) == INVALID_TIME);
+   REQUIRE(cron_nth<cron_quartz_traits>(make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2022"), reference, 2) == INVALID_TIME);
+   REQUIRE(cron_nth<cron_quartz_traits>(make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2022"), reference, 1) == local_time("2022-01-01 00:00:00"));
+}
+
+TEST_CASE("count: ordinal and nth occurrence across DST transitions", "[count]")
+{
+   std::vector<std::string> expressions =
+   {
+      "0 0 * * * *", "0 */20 * * * *", "30 */7 9-17 * * MON-FRI", "15,45 5 3 * * SUN",
+   };
+
+   std::pair<char const *, char const *> const zones[] =
+   {
+      { "EST5EDT,M3.2.0,M11.1.0", "2021-03-06 21:17:43" },
+      { "EST5EDT,M3.2.0,M11.1.0", "2021-10-30 21:17:43" },
+      { "CET-1CEST,M3.5.0,M10.5.0/3", "2021-03-20 21:17:43" },
+      { "CET-1CEST,M3.5.0,M10.5.0/3", "2021-10-23 21:17:43" },
+   };
+
+   for (auto const & [tz, start] : zones)
+   {
+      scoped_time_zone const zone(tz);
+      auto const reference = local_time(start);
+
+      for (auto const & expr : expressions)
+      {
+         INFO(tz << " " << start << " " << expr);
+         auto const cex = make_cron(expr);
+
+         // enough occurrences to get past the transition a week later
+         auto t = reference;
+         for (std::uint64_t k = 1; k <= 400; ++k)
+         {
+            t = cron_next(cex, t);
+            REQUIRE(t != INVALID_TIME);
+
+            REQUIRE(cron_nth(cex, reference, k) == t);
+            REQUIRE(cron_ordinal(cex, reference, t) == k);
+         }
+      }
+   }
+}
+
+TEST_CASE("count: catch-up after downtime", "[count]")
+{
+   auto const last_run = local_time("2021-02-26 21:17:43");
+   auto const now = local_time("2021-03-02 09:30:30");
+
+   std::vector<std::pair<cronexpr, std::time_t>> jobs =
+   {
+      { make_cron("0 0 * * * *"), last_run },
+      { make_cron("30 */7 9-17 * * MON-FRI"), last_run },
+      { make_cron("0 0 0 1 1 *"), last_run },
+      { make_cron("0 0 0 * * *"), now },
+   };
+
+   auto const all = cron_catchup(jobs, now, catchup_policy::fire_all);
+   REQUIRE(all.size() == jobs.size());
+
+   for (size_t i = 0; i < jobs.size(); ++i)
+   {
+      std::vector<std::time_t> fires;
+      for (auto t = cron_next(jobs[i].first, jobs[i].second); t != INVALID_TIME && t <= now; t = cron_next(jobs[i].first, t))
+         fires.push_back(t);
+
+      REQUIRE(all[i].missed == fires.size());
+      REQUIRE(all[i].fires == fires);
+      REQUIRE(all[i].latest == (fires.empty() ? INVALID_TIME : fires.back()));
+   }
+
+   auto const once = cron_catchup(jobs, now, catchup_policy::fire_once);
+   REQUIRE(once[0].missed == 84);
+   REQUIRE(once[0].fires == std::vector<std::time_t>{ local_time("2021-03-02 09:00:00") });
+   REQUIRE(once[2].fires.empty());
+
+   auto const skipped = cron_catchup(jobs, now, catchup_policy::skip);
+   REQUIRE(skipped[1].missed == all[1].missed);
+   REQUIRE(skipped[1].latest == all[1].latest);
+   REQUIRE(skipped[1].fires.empty());
+}
+
+TEST_CASE("count: catch-up across DST transitions", "[count]")
+{
+   scoped_time_zone const zone("EST5EDT,M3.2.0,M11.1.0");
+
+   auto const now = local_time("2021-11-09 12:00:00");
+
+   // the batch shares the transitions it finds, in whatever order the
+   // last runs come
+   std::vector<std::pair<cronexpr, std::time_t>> jobs =
+   {
+      { make_cron("0 0 * * * *"), local_time("2021-10-30 08:00:00") },
+      { make_cron("0 */20 * * * *"), local_time("2021-03-10 12:00:00") },
+      { make_cron("0 15 */2 * * *"), local_time("2021-11-07 00:30:00") },
+      { make_cron("0 30 9 * * MON-FRI"), local_time("2019-06-03 12:00:00") },
+   };
+
+   auto const all = cron_catchup(jobs, now, catchup_policy::fire_all);
+   REQUIRE(all.size() == jobs.size());
+
+   for (size_t i = 0; i < jobs.size(); ++i)
+   {
+      auto const single = cron_catchup(jobs[i].first, jobs[i].second, now, catchup_policy::fire_all);
+      REQUIRE(all[i].missed == enumerate_count(jobs[i].first, jobs[i].second, now));
+      REQUIRE(all[i].missed == single.missed);
+      REQUIRE(all[i].latest == single.latest);
+      REQUIRE(all[i].fires == single.fires);
+      REQUIRE(all[i].fires.size() == all[i].missed);
+   }
+}
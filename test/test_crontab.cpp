@@ -0,0 +1,138 @@
+#include "catch.hpp"
+#include "croncpp_crontab.h"
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <system_error>
+#include <vector>
+
+using namespace cron;
+
+namespace
+{
+   struct collected
+   {
+      std::vector<std::string> expressions;
+      std::vector<std::string> commands;
+      std::vector<size_t>      lines;
+      std::vector<size_t>      error_lines;
+      std::vector<std::string> error_messages;
+
+      auto entry()
+      {
+         return [this](crontab_entry const & e) {
+            expressions.push_back(to_string(e.cex));
+            commands.emplace_back(e.command);
+            lines.push_back(e.line);
+         };
+      }
+
+      auto error()
+      {
+         return [this](crontab_error const & e) {
+            error_lines.push_back(e.line);
+            error_messages.emplace_back(e.message);
+         };
+      }
+   };
+
+   std::string make_cron_error(std::string_view const expr)
+   {
+      try
+      {
+         make_cron(expr);
+      }
+      catch (bad_cronexpr const & ex)
+      {
+         return ex.what();
+      }
+      return {};
+   }
+
+   std::string const sample =
+      "# daily jobs\n"
+      "SHELL=/bin/sh\n"
+      "MAILTO = ops@example.com\n"
+      "\n"
+      "30 2 * * *\t/usr/bin/backup --full\n"
+      "  */15  9-17 * * MON-FRI   check.sh  a  b\r\n"
+      "@hourly rotate\n"
+      "@reboot start.sh\n"
+      "61 * * * * bad-minute\n"
+      "0 0 * *\n"
+      "0 12 1 JAN * new-year";
+}
+
+TEST_CASE("crontab: classic format", "[crontab]")
+{
+   collected result;
+   auto const entries = read_crontab(sample, result.entry(), result.error());
+
+   REQUIRE(entries == 4);
+   REQUIRE(result.expressions == std::vector<std::string>{
+      to_string(make_cron("0 30 2 * * *")),
+      to_string(make_cron("0 */15 9-17 * * MON-FRI")),
+      to_string(make_cron("0 0 * * * *")),
+      to_string(make_cron("0 0 12 1 JAN *")) });
+   REQUIRE(result.commands == std::vector<std::string>{
+      "/usr/bin/backup --full", "check.sh  a  b", "rotate", "new-year" });
+   REQUIRE(result.lines == std::vector<size_t>{ 5, 6, 7, 11 });
+   REQUIRE(result.error_lines == std::vector<size_t>{ 8, 9, 10 });
+   REQUIRE(result.error_messages[0] == "Unsupported crontab macro");
+   REQUIRE(result.error_messages[2] == "Too few fields in crontab line");
+}
+
+TEST_CASE("crontab: errors outlive the call", "[crontab]")
+{
+   std::vector<crontab_error> errors;
+   read_crontab("61 * * * * bad", [](crontab_entry const &) {}, [&errors](crontab_error const & e) { errors.push_back(e); });
+
+   REQUIRE(errors.size() == 1);
+   REQUIRE(!errors[0].message.empty());
+   REQUIRE(errors[0].message == make_cron_error("0 61 * * * *"));
+}
+
+TEST_CASE("crontab: fields with seconds and years", "[crontab]")
+{
+   collected six;
+   REQUIRE(read_crontab("5 0 0 * * * job\n0 0 0 * * *\n", six.entry(), six.error(), 6) == 1);
+   REQUIRE(six.expressions[0] == to_string(make_cron("5 0 0 * * *")));
+   REQUIRE(six.error_messages == std::vector<std::string>{ "Missing command in crontab line" });
+
+   collected seven;
+   REQUIRE(read_crontab<cron_quartz_traits>(
+      "0 0 12 ? * MON 2030 job\n@weekly other\n", seven.entry(), seven.error(), 7) == 2);
+   REQUIRE(seven.expressions[0] == to_string(make_cron<cron_quartz_traits>("0 0 12 ? * MON 2030")));
+   REQUIRE(seven.expressions[1] == to_string(make_cron<cron_quartz_traits>("0 0 0 * * SUN")));
+   REQUIRE(seven.error_lines.empty());
+}
+
+TEST_CASE("crontab: file read in chunks", "[crontab]")
+{
+   std::string const path = "croncpp_crontab_test.txt";
+   {
+      std::ofstream out(path, std::ios::binary);
+      out << sample;
+   }
+
+   collected expected;
+   read_crontab(sample, expected.entry(), expected.error());
+
+   // chunks shorter than a line force lines to be joined across reads
+   for (size_t chunk : { size_t{ 1 }, size_t{ 7 }, size_t{ 64 }, size_t{ 65536 } })
+   {
+      collected result;
+      INFO(chunk);
+      REQUIRE(read_crontab_file(path, result.entry(), result.error(), 5, chunk) == 4);
+      REQUIRE(result.expressions == expected.expressions);
+      REQUIRE(result.commands == expected.commands);
+      REQUIRE(result.lines == expected.lines);
+      REQUIRE(result.error_lines == expected.error_lines);
+   }
+
+   std::remove(path.c_str());
+
+   collected none;
+   REQUIRE_THROWS_AS(read_crontab_file(path, none.entry(), none.error()), std::system_error);
+}
@@ -0,0 +1,117 @@
+#include "catch.hpp"
+#include "croncpp_executor.h"
+#include "croncpp_scheduler.h"
+#include "test_helpers.h"
+
+#include <atomic>
+#include <chrono>
+#include <stdexcept>
+#include <thread>
+
+using namespace cron;
+using namespace test_helpers;
+
+TEST_CASE("executor: runs every task", "[executor]")
+{
+   std::atomic<int> count{ 0 };
+   {
+      work_stealing_executor pool(4);
+      REQUIRE(pool.workers() == 4);
+
+      for (int i = 0; i < 10000; ++i)
+         pool.submit([&count]() { ++count; });
+
+      REQUIRE(wait_until([&pool]() { return pool.stats().executed == 10000; }));
+
+      auto const stats = pool.stats();
+      REQUIRE(stats.queue_depth == 0);
+      REQUIRE(stats.steals <= stats.executed);
+      REQUIRE(stats.failed == 0);
+      REQUIRE(stats.max_wait.count() >= 0);
+      REQUIRE(stats.total_wait >= stats.max_wait);
+   }
+   REQUIRE(count == 10000);
+}
+
+TEST_CASE("executor: a throwing task does not stop its worker", "[executor]")
+{
+   std::atomic<int> count{ 0 };
+   work_stealing_executor pool(1);
+
+   for (int i = 0; i < 100; ++i)
+   {
+      pool.submit([&count, i]() {
+         if (i % 10 == 0) throw std::runtime_error("job failed");
+         ++count;
+      });
+   }
+
+   REQUIRE(wait_until([&pool]() { return pool.stats().executed == 100; }));
+   REQUIRE(pool.stats().failed == 10);
+   REQUIRE(count == 90);
+}
+
+TEST_CASE("executor: tasks spawned by tasks are stolen by idle workers", "[executor]")
+{
+   std::atomic<int> count{ 0 };
+   work_stealing_executor pool(4);
+
+   pool.submit([&pool, &count]() {
+      for (int i = 0; i < 2000; ++i)
+      {
+         pool.submit([&count]() {
+            std::this_thread::sleep_for(std::chrono::microseconds(50));
+            ++count;
+         });
+      }
+   });
+
+   REQUIRE(wait_until([&count]() { return count == 2000; }));
+   REQUIRE(pool.stats().steals > 0);
+}
+
+TEST_CASE("executor: runs fired scheduler jobs", "[executor][scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:59:00");
+   work_stealing_executor pool(2);
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+   sched.set_dispatcher(pool.dispatcher());
+
+   std::atomic<int> count{ 0 };
+   auto const caller = std::this_thread::get_id();
+   std::atomic<bool> other_thread{ true };
+   for (int i = 0; i < 100; ++i)
+   {
+      sched.add(make_cron("0 0 * * * *"), [&](job_id, std::time_t t) {
+         if (std::this_thread::get_id() == caller || t != start + 60) other_thread = false;
+         ++count;
+      });
+   }
+
+   REQUIRE(sched.advance(start + 60) == 100);
+   REQUIRE(wait_until([&count]() { return count == 100; }));
+   REQUIRE(other_thread);
+
+   // the latency runs from the fire time of the manual clock, long past
+   REQUIRE(wait_until([&pool]() { return pool.stats().executed == 100; }));
+   auto const stats = pool.stats();
+   REQUIRE(stats.timed == 100);
+   REQUIRE(stats.max_latency > std::chrono::hours(24));
+   REQUIRE(stats.max_latency > stats.max_wait);
+}
+
+TEST_CASE("executor: latency is measured from the fire time", "[executor]")
+{
+   work_stealing_executor pool(1);
+
+   pool.submit([]() {});
+   pool.dispatcher()([]() {}, wall_clock{}() - 30);
+
+   REQUIRE(wait_until([&pool]() { return pool.stats().executed == 2; }));
+
+   auto const stats = pool.stats();
+   REQUIRE(stats.timed == 1);
+   REQUIRE(stats.max_latency >= std::chrono::seconds(29));
+   REQUIRE(stats.total_latency == stats.max_latency);
+   REQUIRE(stats.max_wait < std::chrono::seconds(5));
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <chrono>
+#include <cstdlib>
+#include <ctime>
+#include <string>
+#include <string_view>
+#include <thread>
+
+#include "croncpp.h"
+
+namespace test_helpers
+{
+   // Parses "YYYY-MM-DD HH:MM:SS" as a local time.
+   inline std::time_t local_time(std::string_view text)
+   {
+      auto tm = cron::utils::to_tm(text);
+      return cron::utils::tm_to_time(tm);
+   }
+
+   // Switches the local time zone, given as a POSIX TZ string such as
+   // "EST5EDT,M3.2.0,M11.1.0", for the lifetime of the object.
+   class scoped_time_zone
+   {
+   public:
+      explicit scoped_time_zone(char const * zone)
+      {
+         if (auto const current = std::getenv("TZ"))
+            previous = current;
+         else
+            was_set = false;
+
+         set(zone);
+      }
+
+      ~scoped_time_zone()
+      {
+         set(was_set ? previous.c_str() : nullptr);
+      }
+
+      scoped_time_zone(scoped_time_zone const &) = delete;
+      scoped_time_zone& operator=(scoped_time_zone const &) = delete;
+
+   private:
+      static void set(char const * zone)
+      {
+#ifdef _WIN32
+         _putenv_s("TZ", zone != nullptr ? zone : "");
+         _tzset();
+#else
+         if (zone != nullptr)
+            setenv("TZ", zone, 1);
+         else
+            unsetenv("TZ");
+         tzset();
+#endif
+      }
+
+      std::string previous;
+      bool        was_set = true;
+   };
+
+   // Polls the condition for up to five seconds.
+   template <typename F>
+   bool wait_until(F&& condition)
+   {
+      for (int i = 0; i < 5000 && !condition(); ++i)
+         std::this_thread::sleep_for(std::chrono::milliseconds(1));
+      return condition();
+   }
+}
@@ -0,0 +1,220 @@
+#include "catch.hpp"
+#include "croncpp_journal.h"
+#include "test_helpers.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   std::string journal_path()
+   {
+      return "/tmp/croncpp_journal_test." + std::to_string(::getpid());
+   }
+
+   struct file_guard
+   {
+      std::string path;
+      ~file_guard() { std::remove(path.c_str()); }
+   };
+}
+
+TEST_CASE("journal: replay gives the last fire of every job", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+   std::remove(guard.path.c_str());
+
+   auto const cex = make_cron("0 */5 * * * *");
+   {
+      fire_journal journal(guard.path);
+      journal.record(1, 1000);
+      journal.record(2, 500);
+      journal.record(1, 1300);
+      journal.record(2, 400);     // an older fire committed late
+
+      REQUIRE(journal.records() == std::make_pair(std::uint64_t{ 4 }, std::uint64_t{ 4 }));
+      REQUIRE(journal.commits() == 4);
+   }
+
+   auto const last = replay_journal(guard.path);
+   REQUIRE(last.size() == 2);
+   REQUIRE(last.at(1) == 1300);
+   REQUIRE(last.at(2) == 500);
+   REQUIRE(cron_next(cex, last.at(1)) == 1500);
+
+   // reopening continues the journal
+   {
+      fire_journal journal(guard.path);
+      REQUIRE(journal.last_fires() == last);
+      journal.record(3, 2000);
+   }
+   REQUIRE(replay_journal(guard.path).size() == 3);
+}
+
+TEST_CASE("journal: batches share commits", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+   std::remove(guard.path.c_str());
+
+   journal_options options;
+   options.sync_interval = std::chrono::hours(1);
+   options.max_batch = 100;
+
+   {
+      fire_journal journal(guard.path, options);
+      for (std::uint64_t i = 0; i < 1050; ++i)
+         journal.record(i % 7, static_cast<std::time_t>(i));
+
+      REQUIRE(journal.commits() == 10);
+      REQUIRE(journal.records().second == 1000);
+
+      journal.sync();
+      REQUIRE(journal.commits() == 11);
+      REQUIRE(journal.records().second == 1050);
+   }
+
+   // with concurrent writers every record is durable when record() returns
+   {
+      fire_journal journal(guard.path);
+      std::vector<std::thread> writers;
+      for (std::uint64_t t = 0; t < 8; ++t)
+      {
+         writers.emplace_back([&journal, t]() {
+            for (std::time_t i = 1; i <= 50; ++i)
+               journal.record(100 + t, 5000 + i);
+         });
+      }
+      for (auto & w : writers)
+         w.join();
+
+      REQUIRE(journal.records().second == 400);
+      REQUIRE(journal.commits() <= 400);
+   }
+
+   auto const last = replay_journal(guard.path);
+   REQUIRE(last.size() == 15);
+   REQUIRE(last.at(6) == 1049);
+   for (std::uint64_t t = 0; t < 8; ++t)
+      REQUIRE(last.at(100 + t) == 5050);
+}
+
+TEST_CASE("journal: waiting records are committed when the interval expires", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+   std::remove(guard.path.c_str());
+
+   journal_options options;
+   options.sync_interval = std::chrono::milliseconds(200);
+
+   fire_journal journal(guard.path, options);
+   journal.record(1, 1000);
+   REQUIRE(journal.records().second == 0);
+
+   // no further record() and no sync()
+   REQUIRE(wait_until([&journal]() { return journal.records().second == 1; }));
+   REQUIRE(journal.commits() == 1);
+   REQUIRE(replay_journal(guard.path).at(1) == 1000);
+
+   journal.record(2, 2000);
+   REQUIRE(wait_until([&journal]() { return journal.records().second == 2; }));
+   REQUIRE(replay_journal(guard.path).at(2) == 2000);
+}
+
+TEST_CASE("journal: torn tail is cut off", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+   std::remove(guard.path.c_str());
+
+   {
+      fire_journal journal(guard.path);
+      journal.record(1, 100);
+      journal.record(1, 200);
+   }
+
+   // a crash in the middle of a write
+   {
+      std::ofstream out(guard.path, std::ios::binary | std::ios::app);
+      char const torn[10] = { 1, 0, 0, 0, 0, 0, 0, 0, 0x2c, 0x01 };
+      out.write(torn, sizeof(torn));
+   }
+
+   REQUIRE(replay_journal(guard.path).at(1) == 200);
+
+   {
+      fire_journal journal(guard.path);
+      journal.record(1, 300);
+   }
+
+   REQUIRE(replay_journal(guard.path).at(1) == 300);
+
+   std::ifstream in(guard.path, std::ios::binary | std::ios::ate);
+   REQUIRE(static_cast<size_t>(in.tellg()) == CRON_JOURNAL_HEADER_SIZE + 3 * CRON_JOURNAL_RECORD_SIZE);
+}
+
+TEST_CASE("journal: torn header is rewritten", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+
+   // a crash while the header of a new journal was written
+   for (size_t length : { 0, 5, 15 })
+   {
+      {
+         std::ofstream out(guard.path, std::ios::binary | std::ios::trunc);
+         out.write("CRONJRNL\1\0\0\0\x18\0\0", static_cast<std::streamsize>(length));
+      }
+
+      {
+         fire_journal journal(guard.path);
+         journal.record(7, 100);
+      }
+
+      REQUIRE(replay_journal(guard.path).at(7) == 100);
+
+      std::ifstream in(guard.path, std::ios::binary | std::ios::ate);
+      REQUIRE(static_cast<size_t>(in.tellg()) == CRON_JOURNAL_HEADER_SIZE + CRON_JOURNAL_RECORD_SIZE);
+   }
+}
+
+TEST_CASE("journal: invalid files", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+
+   {
+      std::ofstream out(guard.path, std::ios::binary | std::ios::trunc);
+      out << "NOTAJOURNALFILE!";
+   }
+
+   REQUIRE_THROWS_AS(replay_journal(guard.path), std::runtime_error);
+   REQUIRE_THROWS_AS(fire_journal(guard.path), std::runtime_error);
+
+   std::remove(guard.path.c_str());
+   REQUIRE_THROWS_AS(replay_journal(guard.path), std::system_error);
+}
+
+TEST_CASE("journal: journaled callbacks", "[journal]")
+{
+   file_guard const guard{ journal_path() };
+   std::remove(guard.path.c_str());
+
+   std::vector<std::time_t> runs;
+   {
+      fire_journal journal(guard.path);
+      auto fn = journaled(journal, [&runs](std::uint64_t, std::time_t t) { runs.push_back(t); });
+      fn(42, 10);
+      fn(42, 20);
+   }
+
+   REQUIRE(runs == std::vector<std::time_t>{ 10, 20 });
+   REQUIRE(replay_journal(guard.path).at(42) == 20);
+}
+
+#endif
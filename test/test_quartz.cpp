@@ -436,3 +436,17 @@ TEST_CASE("quartz: next","[quartz]")
    check_next_quartz("0 0 11 13 * FRI", "2020-08-13 10:00:00", "2020-11-13 11:00:00");
 }
 
+TEST_CASE("quartz: hashed year requires a range", "[quartz]")
+{
+   auto const key = utils::hash_key("yearly-report");
+
+   REQUIRE_THROWS_AS(make_cron<cron_quartz_traits>("0 0 0 1 1 ? H", key), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron<cron_quartz_traits>("0 0 0 1 1 ? H/2", key), bad_cronexpr);
+
+   auto start = utils::to_tm("2021-01-01 00:00:00");
+   auto const next = cron_next<cron_quartz_traits>(make_cron<cron_quartz_traits>("0 0 0 1 1 ? H(2030-2039)", key), utils::tm_to_time(start));
+   std::tm tm;
+   utils::time_to_tm(&next, &tm);
+   REQUIRE(tm.tm_year + 1900 >= 2030);
+   REQUIRE(tm.tm_year + 1900 <= 2039);
+}
@@ -0,0 +1,135 @@
+#include "catch.hpp"
+#include "croncpp_reload.h"
+#include "test_helpers.h"
+
+#include <map>
+#include <string>
+#include <vector>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   using test_scheduler = scheduler<cron_standard_traits, manual_clock>;
+
+   struct fixture
+   {
+      test_scheduler                   sched{ manual_clock{ local_time("2021-03-01 10:00:30") } };
+      std::map<std::string, int>       fires;
+      size_t                           created = 0;
+      crontab_reloader<cron_standard_traits, manual_clock> reloader{ sched, [this](std::string_view command) {
+         ++created;
+         return [this, name = std::string(command)](job_id, std::time_t) { ++fires[name]; };
+      } };
+   };
+}
+
+TEST_CASE("reload: initial load and unchanged reload", "[reload]")
+{
+   fixture f;
+   std::string const crontab =
+      "# header\n"
+      "* * * * * every-minute\n"
+      "*/2 * * * * every-two\n"
+      "* * * * * every-minute\n";
+
+   auto stats = f.reloader.reload(crontab);
+   REQUIRE(stats.added == 3);
+   REQUIRE(f.reloader.size() == 3);
+   REQUIRE(f.sched.pending_commands() == 3);
+
+   f.sched.clock().advance(120);
+   f.sched.tick();
+   REQUIRE(f.sched.size() == 3);
+   REQUIRE(f.fires["every-minute"] == 4);
+   REQUIRE(f.fires["every-two"] == 1);
+
+   // comments, blank lines and spacing do not matter
+   stats = f.reloader.reload("* * * * *   every-minute\n\n# other\n*/2 * * * * every-two\n* * * * * every-minute");
+   REQUIRE(stats.unchanged == 3);
+   REQUIRE(stats.added + stats.updated + stats.removed == 0);
+   REQUIRE(f.sched.pending_commands() == 0);
+   REQUIRE(f.created == 3);
+}
+
+TEST_CASE("reload: only changed lines are applied", "[reload]")
+{
+   fixture f;
+   std::string crontab;
+   for (int i = 0; i < 100; ++i)
+      crontab += std::to_string(i % 60) + " * * * * job-" + std::to_string(i) + "\n";
+
+   f.reloader.reload(crontab);
+   f.sched.apply_commands();
+   REQUIRE(f.sched.size() == 100);
+
+   std::string changed;
+   for (int i = 0; i < 100; ++i)
+   {
+      if (i == 10) continue;                                            // removed
+      if (i == 20) changed += "*/5 * * * * job-20\n";                   // new schedule
+      else if (i == 30) changed += "*/10 * * * * job-thirty\n";         // new command
+      else changed += std::to_string(i % 60) + " * * * * job-" + std::to_string(i) + "\n";
+   }
+   changed += "0 0 * * * job-new\n";
+   changed += "99 * * * * broken\n";
+
+   std::vector<size_t> error_lines;
+   auto const stats = f.reloader.reload(changed, [&](crontab_error const & e) { error_lines.push_back(e.line); });
+
+   REQUIRE(stats.unchanged == 97);
+   REQUIRE(stats.updated == 1);
+   REQUIRE(stats.added == 2);
+   REQUIRE(stats.removed == 2);
+   REQUIRE(stats.errors == 1);
+   REQUIRE(error_lines == std::vector<size_t>{ 101 });
+   REQUIRE(f.sched.pending_commands() == 5);
+   // the updated line gets a callback too, in case its job has to be added back
+   REQUIRE(f.created == 103);
+
+   f.sched.apply_commands();
+   REQUIRE(f.sched.size() == 100);
+   REQUIRE(f.reloader.size() == 100);
+
+   // job-20 now fires every five minutes with its original callback
+   f.sched.clock().advance(600);
+   f.sched.tick();
+   REQUIRE(f.fires["job-20"] == 2);
+   REQUIRE(f.fires["job-10"] == 0);
+   REQUIRE(f.fires["job-thirty"] == 1);
+   REQUIRE(f.fires["job-30"] == 0);
+}
+
+TEST_CASE("reload: removing everything", "[reload]")
+{
+   fixture f;
+   f.reloader.reload("@hourly a\n@daily b\n");
+
+   auto const stats = f.reloader.reload("");
+   REQUIRE(stats.removed == 2);
+   REQUIRE(f.reloader.size() == 0);
+
+   f.sched.apply_commands();
+   REQUIRE(f.sched.size() == 0);
+}
+
+TEST_CASE("reload: a fixed line brings back a job the scheduler dropped", "[reload]")
+{
+   fixture f;
+
+   // February 30th never comes: the job is not inserted
+   auto stats = f.reloader.reload("0 0 30 2 * fixme\n");
+   REQUIRE(stats.added == 1);
+   f.sched.apply_commands();
+   REQUIRE(f.sched.size() == 0);
+
+   stats = f.reloader.reload("* * * * * fixme\n");
+   REQUIRE(stats.updated == 1);
+   f.sched.apply_commands();
+   REQUIRE(f.sched.size() == 1);
+
+   f.sched.clock().advance(600);
+   f.sched.tick();
+   REQUIRE(f.fires["fixme"] == 10);
+}
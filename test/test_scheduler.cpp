@@ -0,0 +1,444 @@
+#include "catch.hpp"
+#include "croncpp_scheduler.h"
+#include "test_helpers.h"
+
+#include <atomic>
+#include <chrono>
+#include <thread>
+#include <vector>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   template <typename Traits>
+   std::vector<std::time_t> expected_fires(cronexpr const & cex, std::time_t from, std::time_t to)
+   {
+      std::vector<std::time_t> result;
+      for (auto t = cron_next<Traits>(cex, from); t != INVALID_TIME && t <= to; t = cron_next<Traits>(cex, t))
+         result.push_back(t);
+      return result;
+   }
+}
+
+TEST_CASE("scheduler: fires every occurrence", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<std::time_t> fires;
+   auto id = sched.add(make_cron("*/5 * * * * *"), [&](job_id, std::time_t t) { fires.push_back(t); });
+   REQUIRE(id != INVALID_JOB);
+   REQUIRE(sched.next_deadline() == start + 5);
+
+   sched.clock().advance(60);
+   REQUIRE(sched.tick() == 12);
+   REQUIRE(fires.size() == 12);
+   REQUIRE(fires.front() == start + 5);
+   REQUIRE(fires.back() == start + 60);
+   REQUIRE(sched.next_deadline() == start + 65);
+}
+
+TEST_CASE("scheduler: matches cron_next across wheel levels", "[scheduler]")
+{
+   auto const start = local_time("2021-12-30 23:58:17");
+   auto const end = start + 3 * 86400 + 4000;
+
+   std::vector<std::string> expressions =
+   {
+      "*/7 * * * * *", "*/20 * 0 * * *", "30 */3 * * * *", "0 0 * * * *",
+      "15 10 4 * * *", "0 0 0 1 * *", "0 59 23 31 12 *", "0 0 12 * * MON-FRI",
+   };
+
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<std::vector<std::time_t>> fires(expressions.size());
+   for (size_t i = 0; i < expressions.size(); ++i)
+      sched.add(make_cron(expressions[i]), [&fires, i](job_id, std::time_t t) { fires[i].push_back(t); });
+
+   for (auto t = start; t < end; t += 997)
+      sched.advance(t);
+   sched.advance(end);
+
+   for (size_t i = 0; i < expressions.size(); ++i)
+      REQUIRE(fires[i] == expected_fires<cron_standard_traits>(make_cron(expressions[i]), start, end));
+}
+
+TEST_CASE("scheduler: far deadlines wait in the overflow list", "[scheduler]")
+{
+   auto const start = local_time("2021-01-01 00:00:00");
+   scheduler<cron_quartz_traits, manual_clock> sched(manual_clock{ start });
+
+   auto const cex = make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2024");
+   std::vector<std::time_t> fires;
+   sched.add(cex, [&](job_id, std::time_t t) { fires.push_back(t); });
+
+   auto const expected = local_time("2024-01-01 00:00:00");
+   REQUIRE(sched.next_deadline() == expected);
+
+   sched.advance(expected - 1);
+   REQUIRE(fires.empty());
+   sched.advance(expected + 86400 * 800);
+   REQUIRE(fires == std::vector<std::time_t>{ expected });
+   REQUIRE(sched.size() == 0);
+}
+
+TEST_CASE("scheduler: cancel", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   int count1 = 0;
+   int count2 = 0;
+   job_id id2 = INVALID_JOB;
+   auto id1 = sched.add(make_cron("* * * * * *"), [&](job_id, std::time_t) {
+      if (++count1 == 3) sched.cancel(id2);
+   });
+   id2 = sched.add(make_cron("* * * * * *"), [&](job_id, std::time_t) { ++count2; });
+
+   sched.advance(start + 10);
+   REQUIRE(count1 == 10);
+   REQUIRE(count2 == 2);
+   REQUIRE(!sched.contains(id2));
+   REQUIRE(!sched.cancel(id2));
+
+   REQUIRE(sched.cancel(id1));
+   sched.advance(start + 20);
+   REQUIRE(count1 == 10);
+   REQUIRE(sched.size() == 0);
+   REQUIRE(sched.next_deadline() == INVALID_TIME);
+}
+
+TEST_CASE("scheduler: coalesces wakeups within tolerance windows", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<std::time_t> fires;
+   auto record = [&](job_id, std::time_t t) { fires.push_back(t); };
+
+   sched.add(make_cron("2 * * * * *"), record, job_options{ 5 });
+   sched.add(make_cron("4 * * * * *"), record, job_options{ 10 });
+   sched.add(make_cron("9 * * * * *"), record);
+   sched.add(make_cron("30 * * * * *"), record, job_options{ 120 });
+
+   REQUIRE(sched.next_deadline() == start + 2);
+   REQUIRE(sched.next_wakeup() == start + 7);
+
+   // one wakeup serves the first two deadlines, each fired at its own time
+   sched.advance(sched.next_wakeup());
+   REQUIRE(fires == std::vector<std::time_t>{ start + 2, start + 4 });
+   REQUIRE(sched.wakeups_saved() == 1);
+
+   REQUIRE(sched.next_wakeup() == start + 9);
+   sched.advance(sched.next_wakeup());
+   REQUIRE(fires.size() == 3);
+
+   // the next 2-second deadline bounds the window of the 30-second job
+   REQUIRE(sched.next_wakeup() == start + 67);
+   sched.advance(sched.next_wakeup());
+   REQUIRE(fires.size() == 6);
+   REQUIRE(sched.wakeups_saved() == 3);
+}
+
+TEST_CASE("sharded scheduler: spreads jobs over shards", "[scheduler][sharded]")
+{
+   auto const start = local_time("2021-03-01 10:30:00");
+   manual_clock clock{ start };
+   sharded_scheduler<cron_standard_traits, manual_clock> sched(4, clock, std::chrono::milliseconds(1));
+
+   std::atomic<int> count{ 0 };
+   std::vector<job_id> ids;
+   for (int i = 0; i < 1000; ++i)
+      ids.push_back(sched.add(make_cron("0 0 * * * *"), [&count](job_id, std::time_t) { ++count; }));
+
+   REQUIRE(wait_until([&sched]() { return sched.size() == 1000; }));
+   for (size_t i = 0; i < sched.shards(); ++i)
+   {
+      REQUIRE(sched.load(i) > 200);
+      REQUIRE(sched.load(i) < 300);
+   }
+
+   for (int i = 0; i < 100; ++i)
+      REQUIRE(sched.cancel(ids[i]));
+   REQUIRE(!sched.cancel(ids[0]));
+   REQUIRE(wait_until([&sched]() { return sched.size() == 900; }));
+
+   clock.set(start + 1800);
+   REQUIRE(wait_until([&count]() { return count == 900; }));
+   REQUIRE(wait_until([&sched]() { return sched.fired() == 900; }));
+
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   REQUIRE(count == 900);
+}
+
+TEST_CASE("sharded scheduler: jobs move off overloaded shards", "[scheduler][sharded]")
+{
+   auto const start = local_time("2021-03-01 10:30:00");
+   manual_clock clock{ start };
+   sharded_scheduler<cron_standard_traits, manual_clock> sched(4, clock, std::chrono::milliseconds(1));
+
+   std::vector<std::atomic<int>> fires(401);
+   std::vector<job_id> ids;
+   for (int i = 0; i < 400; ++i)
+      ids.push_back(sched.add(make_cron("0 0 * * * *"), [&fires](job_id id, std::time_t) { ++fires[id]; }));
+   REQUIRE(wait_until([&sched]() { return sched.size() == 400; }));
+
+   // empty the first shard; the others hand it part of their jobs
+   std::vector<job_id> kept;
+   for (auto const id : ids)
+   {
+      if (sched.shard_of(id) == 0) REQUIRE(sched.cancel(id));
+      else kept.push_back(id);
+   }
+
+   auto const balanced = [&sched, total = kept.size()]() {
+      if (sched.size() != total) return false;
+      for (size_t i = 0; i < sched.shards(); ++i)
+         if (sched.load(i) < total / sched.shards() / 2) return false;
+      return true;
+   };
+   REQUIRE(wait_until(balanced));
+   REQUIRE(sched.migrated() > 0);
+
+   // a moved job is still updated and cancelled through its new shard
+   std::vector<job_id> moved;
+   for (auto const id : kept)
+      if (sched.shard_of(id) == 0) moved.push_back(id);
+   REQUIRE(moved.size() >= 2);
+   REQUIRE(sched.update(moved[0], make_cron("0 45 * * * *")));
+   REQUIRE(sched.cancel(moved[1]));
+   REQUIRE(!sched.cancel(moved[1]));
+   REQUIRE(sched.shard_of(moved[1]) == sched.shards());
+
+   clock.set(start + 1800);
+   REQUIRE(wait_until([&sched, &kept]() { return sched.fired() == kept.size() - 1; }));
+
+   std::this_thread::sleep_for(std::chrono::milliseconds(20));
+   for (auto const id : ids)
+   {
+      auto const expected = (sched.shard_of(id) == sched.shards()) ? 0 : 1;
+      REQUIRE(fires[id] == expected);
+   }
+}
+
+TEST_CASE("sharded scheduler: rejects expressions that never fire", "[scheduler][sharded]")
+{
+   manual_clock clock{ local_time("2021-03-01 10:30:00") };
+   sharded_scheduler<cron_quartz_traits, manual_clock> sched(2, clock, std::chrono::milliseconds(1));
+
+   REQUIRE(sched.add(make_cron<cron_quartz_traits>("0 0 0 1 1 ? 2020"), [](job_id, std::time_t) {}) == INVALID_JOB);
+   REQUIRE(!sched.cancel(INVALID_JOB));
+   REQUIRE(sched.size() == 0);
+}
+
+TEST_CASE("scheduler: update", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<std::time_t> fires;
+   auto id = sched.add(make_cron("0 * * * * *"), [&](job_id, std::time_t t) { fires.push_back(t); });
+   sched.advance(start + 120);
+   REQUIRE(fires.size() == 2);
+
+   REQUIRE(sched.update(id, make_cron("30 * * * * *")));
+   REQUIRE(sched.next_deadline() == start + 150);
+   sched.advance(start + 240);
+   REQUIRE(fires == std::vector<std::time_t>{ start + 60, start + 120, start + 150, start + 210 });
+
+   REQUIRE(!sched.update(id + 1, make_cron("30 * * * * *")));
+}
+
+TEST_CASE("scheduler: commands posted from other threads", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::atomic<int> count{ 0 };
+   std::vector<std::thread> producers;
+   std::vector<std::vector<job_id>> ids(4);
+   for (size_t p = 0; p < 4; ++p)
+   {
+      producers.emplace_back([&, p]() {
+         for (int i = 0; i < 500; ++i)
+            ids[p].push_back(sched.post_add(make_cron("0 * * * * *"), [&count](job_id, std::time_t) { ++count; }));
+         for (int i = 0; i < 100; ++i)
+            sched.post_cancel(ids[p][i]);
+         sched.post_update(ids[p][100], make_cron("0 0 * * * *"));
+      });
+   }
+
+   for (auto t = start; t < start + 50; ++t)
+      sched.advance(t);
+   for (auto & p : producers) p.join();
+
+   REQUIRE(sched.advance(start + 60) == 1596);
+   REQUIRE(sched.pending_commands() == 0);
+   REQUIRE(sched.size() == 1600);
+   REQUIRE(count == 1596);
+}
+
+TEST_CASE("scheduler: misfire policies", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   auto const cex = make_cron("0 * * * * *");
+
+   auto run = [&](misfire_policy const policy) {
+      scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+      std::vector<std::time_t> fires;
+      job_options options;
+      options.misfire = policy;
+      sched.add(cex, [&fires](job_id, std::time_t t) { fires.push_back(t); }, options);
+
+      // on time: no misfire whatever the policy
+      sched.advance(start + 90);
+      REQUIRE(fires == std::vector<std::time_t>{ start + 60 });
+
+      // ten minutes without advancing
+      sched.advance(start + 690);
+      REQUIRE(sched.next_deadline() == start + 720);
+
+      fires.erase(fires.begin());
+      return std::make_pair(fires, sched.misfires());
+   };
+
+   {
+      auto const [fires, stats] = run(misfire_policy::fire_all);
+      REQUIRE(fires.size() == 10);
+      REQUIRE(stats.misfired == 9);
+      REQUIRE(stats.dropped == 0);
+   }
+   // start + 660 is only 30 seconds late and always fires on its own
+   {
+      auto const [fires, stats] = run(misfire_policy::fire_now);
+      REQUIRE(fires == std::vector<std::time_t>{ start + 120, start + 660 });
+      REQUIRE(stats.misfired == 9);
+      REQUIRE(stats.dropped == 8);
+   }
+   {
+      auto const [fires, stats] = run(misfire_policy::skip_to_next);
+      REQUIRE(fires == std::vector<std::time_t>{ start + 660 });
+      REQUIRE(stats.misfired == 9);
+      REQUIRE(stats.dropped == 9);
+   }
+   {
+      auto const [fires, stats] = run(misfire_policy::coalesce);
+      REQUIRE(fires == std::vector<std::time_t>{ start + 600, start + 660 });
+      REQUIRE(stats.misfired == 9);
+      REQUIRE(stats.coalesced == 8);
+      REQUIRE(stats.dropped == 0);
+   }
+}
+
+TEST_CASE("scheduler: misfires are measured past the tolerance window", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   job_options options;
+   options.tolerance = 120;
+   options.misfire = misfire_policy::skip_to_next;
+
+   size_t count = 0;
+   sched.add(make_cron("0 * * * * *"), [&count](job_id, std::time_t) { ++count; }, options);
+
+   for (int i = 0; i < 10; ++i)
+      sched.advance(sched.next_wakeup());
+
+   REQUIRE(count == 30);
+   REQUIRE(sched.misfires().misfired == 0);
+   REQUIRE(sched.misfires().dropped == 0);
+}
+
+TEST_CASE("scheduler: max concurrent callbacks per job", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<std::function<void()>> queued;
+   sched.set_dispatcher([&queued](std::function<void()> task) { queued.push_back(std::move(task)); });
+
+   int count = 0;
+   job_options options;
+   options.max_concurrent = 2;
+   sched.add(make_cron("* * * * * *"), [&count](job_id, std::time_t) { ++count; }, options);
+
+   REQUIRE(sched.advance(start + 5) == 2);
+   REQUIRE(queued.size() == 2);
+   REQUIRE(sched.misfires().overruns == 3);
+
+   for (auto & task : queued) task();
+   queued.clear();
+   REQUIRE(count == 2);
+
+   REQUIRE(sched.advance(start + 6) == 1);
+   REQUIRE(sched.misfires().overruns == 3);
+}
+
+TEST_CASE("scheduler: priority classes and deadline order", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<int> order;
+   auto const cex = make_cron("0 * * * * *");
+
+   auto options = [](priority_class const priority, std::time_t const tolerance) {
+      job_options result;
+      result.priority = priority;
+      result.tolerance = tolerance;
+      return result;
+   };
+
+   sched.add(cex, [&order](job_id, std::time_t) { order.push_back(1); }, options(priority_class::batch, 0));
+   sched.add(cex, [&order](job_id, std::time_t) { order.push_back(2); }, options(priority_class::normal, 30));
+   sched.add(cex, [&order](job_id, std::time_t) { order.push_back(3); }, options(priority_class::critical, 10));
+   sched.add(cex, [&order](job_id, std::time_t) { order.push_back(4); }, options(priority_class::normal, 5));
+   sched.add(cex, [&order](job_id, std::time_t) { order.push_back(5); }, options(priority_class::critical, 10));
+
+   sched.advance(start + 60);
+   REQUIRE(order == std::vector<int>{ 3, 5, 4, 2, 1 });
+
+   REQUIRE(sched.lateness(priority_class::critical).count == 2);
+   REQUIRE(sched.lateness(priority_class::critical).buckets[0] == 2);
+
+   // fires found 100 seconds late land in the 64-127 bucket
+   sched.advance(start + 220);
+   auto const & batch = sched.lateness(priority_class::batch);
+   REQUIRE(batch.count == 3);
+   REQUIRE(batch.buckets[0] == 1);
+   REQUIRE(batch.buckets[7] == 1);
+   REQUIRE(batch.buckets[6] == 1);
+   REQUIRE(batch.max == 100);
+}
+
+TEST_CASE("scheduler: priority order across the seconds of one advance", "[scheduler]")
+{
+   auto const start = local_time("2021-03-01 10:00:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+
+   std::vector<std::function<void()>> queued;
+   sched.set_dispatcher([&queued](std::function<void()> task) { queued.push_back(std::move(task)); });
+
+   std::vector<int> order;
+   auto options = [](priority_class const priority, std::time_t const tolerance) {
+      job_options result;
+      result.priority = priority;
+      result.tolerance = tolerance;
+      return result;
+   };
+
+   sched.add(make_cron("1 * * * * *"), [&order](job_id, std::time_t) { order.push_back(1); }, options(priority_class::batch, 0));
+   sched.add(make_cron("2 * * * * *"), [&order](job_id, std::time_t) { order.push_back(2); }, options(priority_class::normal, 30));
+   sched.add(make_cron("3 * * * * *"), [&order](job_id, std::time_t) { order.push_back(3); }, options(priority_class::normal, 0));
+   sched.add(make_cron("4 * * * * *"), [&order](job_id, std::time_t) { order.push_back(4); }, options(priority_class::critical, 0));
+
+   // a late tick finds all four due
+   REQUIRE(sched.advance(start + 5) == 4);
+   for (auto & task : queued) task();
+   REQUIRE(order == std::vector<int>{ 4, 3, 2, 1 });
+   REQUIRE(sched.wakeups_saved() == 3);
+}
@@ -0,0 +1,139 @@
+#include "catch.hpp"
+#include "croncpp_shm.h"
+#include "test_helpers.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   std::string segment_name()
+   {
+      return "/croncpp_shm_test." + std::to_string(::getpid());
+   }
+
+   struct segment_guard
+   {
+      std::string name;
+      ~segment_guard() { shared_schedule<>::remove(name); }
+   };
+}
+
+TEST_CASE("shm: create and open", "[shm]")
+{
+   segment_guard const guard{ segment_name() };
+   auto const start = local_time("2021-03-01 10:00:00");
+
+   auto const owner = shared_schedule<>::create(guard.name, {
+      { 9, start + 60, make_cron("0 * * * * *") },
+      { 4, start + 3600, make_cron("0 0 * * * *") } });
+
+   REQUIRE_THROWS_AS(shared_schedule<>::create(guard.name, {}), std::system_error);
+   REQUIRE_THROWS_AS(shared_schedule<cron_quartz_traits>::open(guard.name), std::runtime_error);
+
+   auto const worker = shared_schedule<>::open(guard.name);
+   REQUIRE(worker.size() == 2);
+   REQUIRE(worker.id(0) == 4);
+   REQUIRE(worker.find(9) == 1);
+   REQUIRE(worker.find(5) == worker.size());
+   REQUIRE(worker.expression(1) == make_cron("0 * * * * *"));
+   REQUIRE(worker.next(0) == start + 3600);
+   REQUIRE(worker.earliest() == start + 60);
+
+   REQUIRE_THROWS_AS(shared_schedule<>::open("/croncpp_shm_test.missing"), std::system_error);
+}
+
+TEST_CASE("shm: opening a segment that is still being created", "[shm]")
+{
+   segment_guard const guard{ segment_name() };
+
+   // what open() sees after create() sized the segment but before it wrote
+   // the header
+   int const fd = ::shm_open(guard.name.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+   REQUIRE(fd >= 0);
+   REQUIRE(::ftruncate(fd, 2 * CRON_SHM_RECORD_SIZE) == 0);
+   ::close(fd);
+
+   REQUIRE_THROWS_WITH(shared_schedule<>::open(guard.name), "Shared schedule is not initialized");
+}
+
+TEST_CASE("shm: claims are shared between mappings", "[shm]")
+{
+   segment_guard const guard{ segment_name() };
+   auto const start = local_time("2021-03-01 10:00:00");
+
+   auto owner = shared_schedule<>::create(guard.name, { { 1, start + 10, make_cron("*/10 * * * * *") } });
+   auto worker = shared_schedule<>::open(guard.name);
+
+   REQUIRE(worker.claim(0, start + 5) == INVALID_TIME);
+   REQUIRE(worker.claim(0, start + 10) == start + 10);
+   REQUIRE(owner.claim(0, start + 10) == INVALID_TIME);
+   REQUIRE(owner.next(0) == start + 20);
+
+   // missed occurrences are claimed one at a time
+   REQUIRE(owner.claim(0, start + 35) == start + 20);
+   REQUIRE(worker.claim(0, start + 35) == start + 30);
+   REQUIRE(worker.claim(0, start + 35) == INVALID_TIME);
+}
+
+TEST_CASE("shm: every occurrence is claimed exactly once", "[shm]")
+{
+   segment_guard const guard{ segment_name() };
+   auto const start = local_time("2021-03-01 10:00:00");
+   auto const end = start + 600;
+
+   std::vector<snapshot_entry> entries;
+   std::vector<std::string> const expressions = { "* * * * * *", "*/3 * * * * *", "0 * * * * *", "7,19 * * * * *" };
+   for (size_t i = 0; i < expressions.size(); ++i)
+   {
+      auto const cex = make_cron(expressions[i]);
+      entries.push_back({ i + 1, cron_next(cex, start), cex });
+   }
+
+   auto owner = shared_schedule<>::create(guard.name, entries);
+
+   std::vector<std::vector<std::time_t>> claimed(4 * entries.size());
+   std::vector<std::thread> workers;
+   for (size_t w = 0; w < 4; ++w)
+   {
+      workers.emplace_back([&, w]() {
+         auto view = shared_schedule<>::open(guard.name);
+         for (auto now = start; now <= end; now += 5)
+         {
+            for (size_t i = 0; i < view.size(); ++i)
+            {
+               for (auto t = view.claim(i, now); t != INVALID_TIME; t = view.claim(i, now))
+                  claimed[w * entries.size() + i].push_back(t);
+            }
+         }
+      });
+   }
+
+   for (auto & t : workers)
+      t.join();
+
+   for (size_t i = 0; i < entries.size(); ++i)
+   {
+      std::vector<std::time_t> all;
+      for (size_t w = 0; w < 4; ++w)
+         all.insert(all.end(), claimed[w * entries.size() + i].begin(), claimed[w * entries.size() + i].end());
+      std::sort(all.begin(), all.end());
+
+      std::vector<std::time_t> expected;
+      for (auto t = cron_next(entries[i].cex, start); t <= end; t = cron_next(entries[i].cex, t))
+         expected.push_back(t);
+
+      INFO(expressions[i]);
+      REQUIRE(all == expected);
+   }
+}
+
+#endif
@@ -0,0 +1,143 @@
+#include "catch.hpp"
+#include "croncpp_snapshot.h"
+#include "croncpp_scheduler.h"
+
+#if defined(__unix__) || defined(__APPLE__)
+
+#include <cstdio>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cron;
+
+namespace
+{
+   std::string snapshot_path()
+   {
+      return "/tmp/croncpp_snapshot_test." + std::to_string(::getpid());
+   }
+}
+
+TEST_CASE("snapshot: write and map", "[snapshot]")
+{
+   auto const path = snapshot_path();
+
+   std::vector<snapshot_entry> entries;
+   std::vector<std::string> expressions = { "0 0 12 * * ?", "*/5 * * * * ?", "0 0 0 1 1 ? 2030" };
+   for (size_t i = 0; i < 3000; ++i)
+   {
+      auto const cex = make_cron<cron_quartz_traits>(expressions[i % expressions.size()]);
+      entries.push_back(snapshot_entry{ 1000 + i, static_cast<std::time_t>(1600000000 + i), cex });
+   }
+
+   write_snapshot<cron_quartz_traits>(path, entries);
+
+   {
+      snapshot_view<cron_quartz_traits> view(path);
+      REQUIRE(view.size() == entries.size());
+
+      for (size_t i = 0; i < view.size(); i += 7)
+      {
+         REQUIRE(view.id(i) == entries[i].id);
+         REQUIRE(view.next(i) == entries[i].next);
+         REQUIRE(to_string(view.expression(i)) == to_string(entries[i].cex));
+      }
+
+      // replacing the file does not disturb a reader of the old snapshot
+      write_snapshot<cron_quartz_traits>(path, { entries[0] });
+      REQUIRE(view.id(2999) == 3999);
+
+      snapshot_view<cron_quartz_traits> replaced(path);
+      REQUIRE(replaced.size() == 1);
+      REQUIRE(replaced[0].id == 1000);
+   }
+
+   REQUIRE_THROWS_AS(snapshot_view<cron_standard_traits>(path), std::runtime_error);
+
+   std::remove(path.c_str());
+   REQUIRE_THROWS_AS(snapshot_view<cron_quartz_traits>(path), std::system_error);
+}
+
+TEST_CASE("snapshot: rejects corrupt files", "[snapshot]")
+{
+   auto const path = snapshot_path();
+
+   write_snapshot(path, {});
+   REQUIRE(snapshot_view<>(path).size() == 0);
+
+   {
+      std::ofstream file(path, std::ios::binary | std::ios::app);
+      file << "extra";
+   }
+   REQUIRE_THROWS_AS(snapshot_view<>(path), std::runtime_error);
+
+   {
+      std::ofstream file(path, std::ios::binary | std::ios::trunc);
+      file << "CRONSNAP";
+   }
+   REQUIRE_THROWS_AS(snapshot_view<>(path), std::runtime_error);
+
+   std::remove(path.c_str());
+}
+
+TEST_CASE("snapshot: concurrent writers of one file", "[snapshot]")
+{
+   auto const path = snapshot_path();
+   auto const cex = make_cron("0 0 * * * *");
+
+   // each writer writes snapshots of a different size
+   std::vector<std::thread> writers;
+   for (size_t w = 1; w <= 4; ++w)
+   {
+      writers.emplace_back([&path, &cex, w]() {
+         std::vector<snapshot_entry> entries(w * 100, snapshot_entry{ w, 0, cex });
+         for (int i = 0; i < 50; ++i)
+            write_snapshot(path, entries);
+      });
+   }
+   for (auto & t : writers)
+      t.join();
+
+   snapshot_view<> view(path);
+   REQUIRE(view.size() > 0);
+   REQUIRE(view.size() == view.id(0) * 100);
+   REQUIRE(view.id(view.size() - 1) == view.id(0));
+
+   std::remove(path.c_str());
+}
+
+TEST_CASE("snapshot: restores a scheduler", "[snapshot]")
+{
+   auto const path = snapshot_path();
+   auto start_tm = utils::to_tm("2021-03-01 10:00:00");
+   auto const start = utils::tm_to_time(start_tm);
+
+   {
+      scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+      std::vector<snapshot_entry> entries;
+      for (auto expr : { "0 */5 * * * *", "30 0 12 * * *" })
+      {
+         auto const cex = make_cron(expr);
+         entries.push_back(snapshot_entry{ sched.add(cex, [](job_id, std::time_t) {}), cron_next(cex, start), cex });
+      }
+      write_snapshot(path, entries);
+   }
+
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start + 60 });
+   std::vector<job_id> fired;
+
+   snapshot_view<> view(path);
+   for (size_t i = 0; i < view.size(); ++i)
+      REQUIRE(sched.insert_at(view.id(i), view.expression(i), [&fired](job_id id, std::time_t) { fired.push_back(id); }, view.next(i)));
+
+   REQUIRE(sched.next_deadline() == start + 300);
+   sched.advance(start + 7200);
+   REQUIRE(fired.size() == 24);
+
+   std::remove(path.c_str());
+}
+
+#endif
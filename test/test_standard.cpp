@@ -411,3 +411,137 @@ TEST_CASE("next", "[std]")
    check_next("0 30 23 30 1/3 ?",  "2011-01-30 23:30:00", "2011-04-30 23:30:00");
    check_next("0 30 23 30 1/3 ?",  "2011-04-30 23:30:00", "2011-07-30 23:30:00");    
 }
+
+TEST_CASE("standard: hashed fields", "[std]")
+{
+   auto const key = utils::hash_key("nightly-backup");
+
+   REQUIRE_THROWS_AS(make_cron("0 H * * * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 H(5) * * * *", key), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 H(30-20) * * * *", key), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 H(0-60) * * * *", key), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 H/0 * * * *", key), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 Hx * * * *", key), bad_cronexpr);
+
+   REQUIRE(make_cron("H H H * * *", key) == make_cron("H H H * * *", key));
+   REQUIRE(make_cron("0 H * * * *", key) == make_cron("0 H(0-59) * * * *", key));
+
+   auto start = utils::to_tm("2021-03-01 00:00:00");
+   auto const origin = utils::tm_to_time(start);
+
+   std::tm tm;
+   auto next = cron_next(make_cron("0 H(0-29) * * * *", key), origin);
+   utils::time_to_tm(&next, &tm);
+   REQUIRE(tm.tm_min < 30);
+   REQUIRE(tm.tm_sec == 0);
+
+   // H/15 picks one offset below 15 and keeps the increment
+   auto const cex = make_cron("0 H/15 * * * *", key);
+   auto const first = cron_next(cex, origin);
+   REQUIRE(first - origin < 15 * 60);
+   REQUIRE(cron_next(cex, first) == first + 15 * 60);
+   REQUIRE(cron_next(cex, first + 15 * 60) == first + 30 * 60);
+
+   next = cron_next(make_cron("0 0 0 * * H(MON-FRI)", key), origin);
+   utils::time_to_tm(&next, &tm);
+   REQUIRE(tm.tm_wday >= 1);
+   REQUIRE(tm.tm_wday <= 5);
+}
+
+TEST_CASE("standard: hashed day of month exists in every month", "[std]")
+{
+   auto start = utils::to_tm("2021-01-01 00:00:00");
+   auto const origin = utils::tm_to_time(start);
+
+   for (int i = 0; i < 1000; ++i)
+   {
+      auto const key = utils::hash_key("job-" + std::to_string(i));
+      REQUIRE(cron_next(make_cron("0 0 0 H 2 *", key), origin) != INVALID_TIME);
+
+      auto const next = cron_next(make_cron("0 0 0 H/30 * *", key), origin - 1);
+      std::tm tm;
+      utils::time_to_tm(&next, &tm);
+      REQUIRE(tm.tm_mday <= 28);
+   }
+
+   // an explicit range may still reach the end of the month
+   auto const key = utils::hash_key("month-end");
+   REQUIRE(make_cron("0 0 0 H(31-31) * *", key) == make_cron("0 0 0 31 * *"));
+}
+
+TEST_CASE("standard: hashed fields spread over keys", "[std]")
+{
+   std::vector<cronexpr> minutes;
+   for (int i = 0; i < 600; ++i)
+   {
+      auto const cex = make_cron("0 H * * * *", utils::hash_key("job-" + std::to_string(i)));
+      if (std::find(minutes.begin(), minutes.end(), cex) == minutes.end())
+         minutes.push_back(cex);
+   }
+
+   REQUIRE(minutes.size() == 60);
+}
+
+TEST_CASE("standard: tokens across vector blocks", "[std]")
+{
+   // a reference split, one character at a time
+   auto const reference = [](std::string_view text, char const delimiter) {
+      std::vector<std::string> tokens(1);
+      for (auto const ch : text)
+      {
+         if (ch == delimiter) tokens.emplace_back();
+         else tokens.back().push_back(ch);
+      }
+      if (tokens.back().empty()) tokens.pop_back();
+      return tokens;
+   };
+
+   std::string text;
+   for (int i = 0; i < 100; ++i)
+   {
+      text += (i % 7 == 0) ? "," : std::to_string(i % 10);
+      REQUIRE(utils::split(text, ',') == reference(text, ','));
+      REQUIRE(utils::split("," + text + ",,", ',') == reference("," + text + ",,", ','));
+   }
+
+   REQUIRE(utils::split("", ',').empty());
+}
+
+TEST_CASE("standard: long lists", "[std]")
+{
+   std::string seconds;
+   for (int i = 59; i >= 0; i -= 2)
+      seconds += std::to_string(i) + (i > 1 ? "," : "");
+
+   REQUIRE(make_cron(seconds + "   0  0 * * *") == make_cron("1/2 0 0 * * *"));
+   REQUIRE(make_cron("0 0 0 1,2,3,4,5,6,7,8,9,10,11,12,13,14,15,16,17,18,19,20 * MON,TUE,WED") ==
+           make_cron("0 0 0 1-20 * 1-3"));
+
+   REQUIRE_THROWS_AS(make_cron(seconds + ",, 0 0 * * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron(seconds + ",70 0 0 * * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 0 0 1-2-3 * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 0 0 1- * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 0/ 0 * * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 0/5/5 0 * * *"), bad_cronexpr);
+   REQUIRE_THROWS_AS(make_cron("0 0 0 70000 * *"), bad_cronexpr);
+}
+
+TEST_CASE("standard: names in any position and case", "[std]")
+{
+   CRON_STD_EQUAL("* * * * * 1,3", "* * * * * MON,WED,mon");
+   CRON_STD_EQUAL("* * * * * 1-3,5", "* * * * * Mon-Wed,fri,MON");
+   CRON_STD_EQUAL("* * * * 1,4,7,10 *", "* * * * JAN/3 *");
+   CRON_STD_EQUAL("* * * * 2-4 *", "* * * * feb-APR,Mar *");
+   CRON_STD_EQUAL("* * * * * 0-6/2", "* * * * * SUN-SAT/2");
+
+   CRON_EXPECT_EXCEPT("* * * * * MONDAY");
+   CRON_EXPECT_EXCEPT("* * * * * MO");
+   CRON_EXPECT_EXCEPT("* * * * * JAN");
+   CRON_EXPECT_EXCEPT("* * * * MON *");
+   CRON_EXPECT_EXCEPT("* * * JAN * *");
+   CRON_EXPECT_EXCEPT("* * * * */JAN *");
+   CRON_EXPECT_EXCEPT("* * * * J@N *");
+
+   REQUIRE(make_cron<cron_oracle_traits>("* * * * JAN-MAR SUN,sat") == make_cron<cron_oracle_traits>("* * * * 0-2 1,7"));
+   REQUIRE(make_cron<cron_quartz_traits>("* * * ? dec SUN") == make_cron<cron_quartz_traits>("* * * ? 12 1"));
+}
@@ -0,0 +1,99 @@
+#include "catch.hpp"
+#include "croncpp_table.h"
+#include "test_helpers.h"
+
+#include <atomic>
+#include <string>
+#include <thread>
+#include <vector>
+
+using namespace cron;
+using namespace test_helpers;
+
+namespace
+{
+   // every job of version v fires at second v % 60
+   std::vector<table_entry> make_entries(std::uint64_t const version, size_t const count)
+   {
+      std::vector<table_entry> entries;
+      for (size_t i = count; i > 0; --i)
+         entries.push_back(table_entry{ i, make_cron(std::to_string(version % 60) + " * * * * *") });
+      return entries;
+   }
+}
+
+TEST_CASE("table: lookup and next times", "[table]")
+{
+   schedule_table<> table({ { 7, make_cron("0 0 12 * * *") }, { 3, make_cron("0 30 * * * *") } }, 5);
+
+   REQUIRE(table.version() == 5);
+   REQUIRE(table.size() == 2);
+   REQUIRE(table.begin()->id == 3);
+   REQUIRE(table.find(7) != nullptr);
+   REQUIRE(*table.find(7) == make_cron("0 0 12 * * *"));
+   REQUIRE(table.find(4) == nullptr);
+
+   auto const start = local_time("2021-03-01 10:00:00");
+   REQUIRE(table.next(7, start) == local_time("2021-03-01 12:00:00"));
+   REQUIRE(table.next(4, start) == INVALID_TIME);
+   REQUIRE(table.earliest(start) == std::make_pair(job_id{ 3 }, local_time("2021-03-01 10:30:00")));
+
+   REQUIRE_THROWS_AS(schedule_table<>({ { 1, cronexpr{} }, { 1, cronexpr{} } }, 1), std::invalid_argument);
+}
+
+TEST_CASE("table: publishing keeps snapshots intact", "[table]")
+{
+   schedule_publisher<> publisher(make_entries(1, 3));
+
+   auto const old = publisher.snapshot();
+   REQUIRE(old->version() == 1);
+
+   REQUIRE(publisher.publish(make_entries(2, 4)) == 2);
+   REQUIRE(publisher.modify([](std::vector<table_entry>& entries) { entries.pop_back(); }) == 3);
+
+   REQUIRE(old->size() == 3);
+   REQUIRE(*old->find(1) == make_cron("1 * * * * *"));
+   REQUIRE(publisher.snapshot()->size() == 3);
+   REQUIRE(publisher.snapshot()->find(4) == nullptr);
+   REQUIRE(publisher.version() == 3);
+}
+
+TEST_CASE("table: readers see consistent versions while publishing", "[table]")
+{
+   schedule_publisher<> publisher(make_entries(1, 50));
+   std::atomic<bool> done{ false };
+   std::atomic<size_t> inconsistent{ 0 };
+   std::atomic<size_t> reads{ 0 };
+
+   std::vector<std::thread> readers;
+   for (int r = 0; r < 4; ++r)
+   {
+      readers.emplace_back([&]() {
+         std::uint64_t last = 0;
+         while (!done.load())
+         {
+            auto const table = publisher.snapshot();
+            auto const expected = make_cron(std::to_string(table->version() % 60) + " * * * * *");
+            if (table->version() < last || table->size() != 50)
+               ++inconsistent;
+            for (auto const & entry : *table)
+               if (entry.cex != expected) ++inconsistent;
+            last = table->version();
+            ++reads;
+         }
+      });
+   }
+
+   for (std::uint64_t v = 2; v <= 200; ++v)
+      REQUIRE(publisher.publish(make_entries(v, 50)) == v);
+
+   while (reads.load() < 100)
+      std::this_thread::yield();
+
+   done = true;
+   for (auto & t : readers)
+      t.join();
+
+   REQUIRE(inconsistent == 0);
+   REQUIRE(publisher.version() == 200);
+}
@@ -0,0 +1,149 @@
+#include "catch.hpp"
+#include "croncpp_timerfd.h"
+#include "test_helpers.h"
+
+#ifdef __linux__
+
+#include <sys/epoll.h>
+
+#include <thread>
+
+using namespace cron;
+using namespace test_helpers;
+
+TEST_CASE("timerfd: wakes an epoll loop at the earliest deadline", "[timerfd]")
+{
+   scheduler<> sched;
+   timerfd_driver<scheduler<>> driver(sched);
+
+   driver.arm();
+   REQUIRE(driver.rearm_count() == 0);
+   REQUIRE(driver.deadline() == INVALID_TIME);
+
+   int fired = 0;
+   sched.add(make_cron("* * * * * *"), [&fired](job_id, std::time_t) { ++fired; });
+   sched.add(make_cron("0 0 12 1 1 *"), [](job_id, std::time_t) {});
+
+   driver.arm();
+   driver.arm();
+   REQUIRE(driver.rearm_count() == 1);
+   REQUIRE(driver.deadline() == sched.next_deadline());
+
+   int const epfd = ::epoll_create1(EPOLL_CLOEXEC);
+   REQUIRE(epfd >= 0);
+
+   epoll_event ev{};
+   ev.events = EPOLLIN;
+   ev.data.fd = driver.fd();
+   REQUIRE(::epoll_ctl(epfd, EPOLL_CTL_ADD, driver.fd(), &ev) == 0);
+
+   auto const first = driver.deadline();
+
+   epoll_event out{};
+   REQUIRE(::epoll_wait(epfd, &out, 1, 2500) == 1);
+   REQUIRE(out.data.fd == driver.fd());
+   REQUIRE(wall_clock{}() >= first);
+
+   REQUIRE(driver.on_readable() >= 1);
+   REQUIRE(fired >= 1);
+   REQUIRE(driver.deadline() > first);
+   REQUIRE(driver.deadline() == sched.next_deadline());
+   REQUIRE(driver.rearm_count() == 2);
+   REQUIRE(driver.clock_change_count() == 0);
+
+   ::close(epfd);
+}
+
+TEST_CASE("timerfd: posted commands wake the loop", "[timerfd]")
+{
+   scheduler<> sched;
+   timerfd_driver<scheduler<>> driver(sched);
+
+   int const epfd = ::epoll_create1(EPOLL_CLOEXEC);
+   REQUIRE(epfd >= 0);
+
+   for (int const fd : { driver.fd(), driver.event_fd() })
+   {
+      epoll_event ev{};
+      ev.events = EPOLLIN;
+      ev.data.fd = fd;
+      REQUIRE(::epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) == 0);
+   }
+
+   // no job: the timer is disarmed, only the eventfd can wake the loop
+   driver.arm();
+   REQUIRE(driver.deadline() == INVALID_TIME);
+
+   job_id id = INVALID_JOB;
+   std::thread poster([&] { id = driver.post_add(make_cron("0 0 12 1 1 *"), [](job_id, std::time_t) {}); });
+   poster.join();
+
+   epoll_event out{};
+   REQUIRE(::epoll_wait(epfd, &out, 1, 2500) == 1);
+   REQUIRE(out.data.fd == driver.event_fd());
+
+   REQUIRE(driver.on_readable() == 0);
+   REQUIRE(driver.notification_count() == 1);
+   REQUIRE(sched.size() == 1);
+   REQUIRE(driver.deadline() == sched.next_deadline());
+   REQUIRE(driver.deadline() != INVALID_TIME);
+
+   // a far deadline does not delay a posted change
+   sched.post_update(id, make_cron("0 0 12 1 6 *"));
+   driver.notify();
+
+   REQUIRE(::epoll_wait(epfd, &out, 1, 2500) == 1);
+   REQUIRE(out.data.fd == driver.event_fd());
+
+   driver.on_readable();
+   REQUIRE(driver.deadline() == sched.next_deadline());
+
+   driver.post_cancel(id);
+   REQUIRE(::epoll_wait(epfd, &out, 1, 2500) == 1);
+   driver.on_readable();
+   REQUIRE(sched.size() == 0);
+   REQUIRE(driver.deadline() == INVALID_TIME);
+   REQUIRE(::epoll_wait(epfd, &out, 1, 0) == 0);
+
+   ::close(epfd);
+}
+
+TEST_CASE("timerfd: jobs posted to an idle scheduler do not fire retroactively", "[timerfd]")
+{
+   auto const start = local_time("2021-03-01 09:30:00");
+   scheduler<cron_standard_traits, manual_clock> sched(manual_clock{ start });
+   timerfd_driver<scheduler<cron_standard_traits, manual_clock>> driver(sched);
+
+   int fired = 0;
+   auto const count = [&fired](job_id, std::time_t) { ++fired; };
+
+   // nothing ticked the scheduler for six hours
+   sched.clock().set(start + 6 * 3600);
+
+   auto const id = driver.post_add(make_cron("0 0 * * * *"), count);
+   REQUIRE(driver.on_readable() == 0);
+   REQUIRE(sched.contains(id));
+   REQUIRE(sched.next_deadline() == local_time("2021-03-01 16:00:00"));
+
+   sched.clock().advance(3600);
+   driver.post_update(id, make_cron("0 */15 * * * *"));
+   REQUIRE(driver.on_readable() == 0);
+   REQUIRE(sched.next_deadline() == local_time("2021-03-01 16:45:00"));
+
+   driver.post_cancel(id);
+   REQUIRE(driver.on_readable() == 0);
+   REQUIRE(sched.size() == 0);
+
+   // the same holds without the command queue
+   sched.clock().advance(3600);
+   sched.add(make_cron("0 0 * * * *"), count);
+   REQUIRE(sched.next_deadline() == local_time("2021-03-01 18:00:00"));
+   REQUIRE(sched.tick() == 0);
+   REQUIRE(fired == 0);
+
+   sched.clock().advance(30 * 60);
+   REQUIRE(driver.on_readable() == 1);
+   REQUIRE(fired == 1);
+}
+
+#endif